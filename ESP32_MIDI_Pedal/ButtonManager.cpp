@@ -3,68 +3,122 @@
  */
 
 #include "ButtonManager.h"
+#include <esp_timer.h>
+
+// ButtonEventQueue implementation
+ButtonEventQueue::ButtonEventQueue() {
+    head = 0;
+    count = 0;
+    overflowCount = 0;
+}
+
+bool ButtonEventQueue::push(const ButtonEvent& event) {
+    if (count >= CAPACITY) {
+        overflowCount++;
+        return false;
+    }
+    
+    // Insertion from the tail: events mostly arrive in order, so this is
+    // usually a single comparison. Equal timestamps keep arrival order.
+    uint8_t pos = count;
+    while (pos > 0) {
+        const ButtonEvent& prev = events[(head + pos - 1) % CAPACITY];
+        if ((long)(event.timestamp - prev.timestamp) >= 0) break;
+        events[(head + pos) % CAPACITY] = prev;
+        pos--;
+    }
+    events[(head + pos) % CAPACITY] = event;
+    count++;
+    return true;
+}
+
+bool ButtonEventQueue::pop(ButtonEvent& event) {
+    if (count == 0) return false;
+    event = events[head];
+    head = (head + 1) % CAPACITY;
+    count--;
+    return true;
+}
+
+uint8_t ButtonEventQueue::size() {
+    return count;
+}
+
+uint32_t ButtonEventQueue::getOverflowCount() {
+    return overflowCount;
+}
 
 // Button implementation
 Button::Button() {
     pin = 0;
+    number = 0;
     lastState = HIGH;
     currentState = HIGH;
-    lastDebounceTime = 0;
-    pressStartTime = 0;
+    lastEdgeUs = 0;
+    pressStartUs = 0;
     longPressTriggered = false;
 }
 
-void Button::init(uint8_t buttonPin) {
+void Button::init(uint8_t buttonPin, uint8_t buttonNumber) {
     pin = buttonPin;
+    number = buttonNumber;
     pinMode(pin, INPUT_PULLUP);
     lastState = digitalRead(pin);
     currentState = lastState;
 }
 
-ButtonEvent Button::update() {
+void Button::pushEvent(ButtonEventQueue& queue, ButtonEventType type, int64_t timeUs) {
     ButtonEvent event;
-    event.type = BUTTON_NONE;
-    event.buttonNumber = 0;
-    event.timestamp = millis();
-    
-    bool reading = digitalRead(pin);
-    
-    // Check if button state has changed
-    if (reading != lastState) {
-        lastDebounceTime = millis();
+    event.buttonNumber = number;
+    event.type = type;
+    event.timestamp = (unsigned long)(timeUs / 1000);
+    queue.push(event);
+}
+
+void Button::onEdge(bool level, int64_t timeUs, ButtonEventQueue& queue) {
+    // Resolve everything the previous level implied before this edge, so a
+    // press and release that both landed during a slow loop each get an event
+    update(timeUs, queue);
+    lastState = level;
+    lastEdgeUs = timeUs;
+}
+
+void Button::syncLevel(bool level, int64_t timeUs, ButtonEventQueue& queue) {
+    // Safety net for edges lost to a ring overflow
+    if (level != lastState) {
+        onEdge(level, timeUs, queue);
     }
-    
-    // Debounce check
-    if ((millis() - lastDebounceTime) > DEBOUNCE_DELAY) {
+}
+
+void Button::update(int64_t nowUs, ButtonEventQueue& queue) {
+    // Debounce check on edge timestamps, independent of when we are scanned
+    if ((nowUs - lastEdgeUs) > (int64_t)DEBOUNCE_DELAY * 1000) {
         // If the button state has changed
-        if (reading != currentState) {
-            currentState = reading;
+        if (lastState != currentState) {
+            currentState = lastState;
             
             if (currentState == LOW) {
                 // Button pressed
-                pressStartTime = millis();
+                pressStartUs = lastEdgeUs;
                 longPressTriggered = false;
-                event.type = BUTTON_PRESS;
+                pushEvent(queue, BUTTON_PRESS, lastEdgeUs);
             } else {
                 // Button released
                 if (!longPressTriggered) {
-                    event.type = BUTTON_RELEASE;
+                    pushEvent(queue, BUTTON_RELEASE, lastEdgeUs);
                 }
-                pressStartTime = 0;
-            }
-        }
-        
-        // Check for long press
-        if (currentState == LOW && !longPressTriggered && pressStartTime > 0) {
-            if (millis() - pressStartTime >= LONG_PRESS_TIME) {
-                longPressTriggered = true;
-                event.type = BUTTON_LONG_PRESS;
             }
         }
     }
     
-    lastState = reading;
-    return event;
+    // Check for long press
+    if (currentState == LOW && lastState == LOW && !longPressTriggered) {
+        int64_t longPressUs = pressStartUs + (int64_t)LONG_PRESS_TIME * 1000;
+        if (nowUs >= longPressUs) {
+            longPressTriggered = true;
+            pushEvent(queue, BUTTON_LONG_PRESS, longPressUs);
+        }
+    }
 }
 
 bool Button::isPressed() {
@@ -72,54 +126,120 @@ bool Button::isPressed() {
 }
 
 bool Button::isLongPressed() {
-    return isPressed() && (millis() - pressStartTime >= LONG_PRESS_TIME);
+    return isPressed() && (esp_timer_get_time() - pressStartUs >= (int64_t)LONG_PRESS_TIME * 1000);
 }
 
 // ButtonManager implementation
 ButtonManager::ButtonManager() {
+    reportedOverflows = 0;
 }
 
 void ButtonManager::begin() {
     for (int i = 0; i < BUTTON_COUNT; i++) {
-        buttons[i].init(buttonPins[i]);
+        buttons[i].init(buttonPins[i], i + 1);  // Button numbers are 1-based
     }
+#if BUTTON_BATCH_SCAN
+    debouncer.begin(buttonPins, BUTTON_COUNT, BUTTON_SAMPLE_PERIOD, DEBOUNCE_DELAY, LONG_PRESS_TIME);
+#else
+    edgeCapture.begin(buttonPins, BUTTON_COUNT);
+#endif
     Serial.println("Button Manager initialized");
 }
 
-ButtonEvent ButtonManager::update() {
-    ButtonEvent event;
-    event.type = BUTTON_NONE;
-    event.buttonNumber = 0;
+uint8_t ButtonManager::update() {
+#if BUTTON_BATCH_SCAN
+    updateBatch();
+#else
+    // Feed timestamped edges from the GPIO ISR to their buttons
+    ButtonEdge edge;
+    while (edgeCapture.pop(edge)) {
+        buttons[edge.button].onEdge(edge.level, edge.timeUs, eventQueue);
+    }
     
-    // Check each button for events
+    // Every button queues all of its events, none is held back for a later scan
+    int64_t nowUs = esp_timer_get_time();
     for (int i = 0; i < BUTTON_COUNT; i++) {
-        ButtonEvent buttonEvent = buttons[i].update();
-        if (buttonEvent.type != BUTTON_NONE) {
-            event = buttonEvent;
-            event.buttonNumber = i + 1;  // Button numbers are 1-based
-            break;  // Return first event found
-        }
+        buttons[i].syncLevel(edgeCapture.readLevel(i), nowUs, eventQueue);
+        buttons[i].update(nowUs, eventQueue);
     }
+#endif
     
-    return event;
+    if (eventQueue.getOverflowCount() != reportedOverflows) {
+        reportedOverflows = eventQueue.getOverflowCount();
+        Serial.printf("Button event queue overflow (%lu dropped)\n", (unsigned long)reportedOverflows);
+    }
+    
+    return eventQueue.size();
+}
+
+void ButtonManager::updateBatch() {
+    unsigned long now = millis();
+    
+    // One register read debounces every button
+    if (debouncer.update(now)) {
+        pushMask(debouncer.takePressed(), BUTTON_PRESS, now);
+        pushMask(debouncer.takeLongPressed(), BUTTON_LONG_PRESS, now);
+        pushMask(debouncer.takeReleased(), BUTTON_RELEASE, now);
+    }
+}
+
+void ButtonManager::pushMask(uint32_t mask, ButtonEventType type, unsigned long timestamp) {
+    while (mask) {
+        uint8_t index = __builtin_ctz(mask);
+        mask &= ~(1UL << index);
+        
+        ButtonEvent event;
+        event.buttonNumber = index + 1;  // Button numbers are 1-based
+        event.type = type;
+        event.timestamp = timestamp;
+        eventQueue.push(event);
+    }
+}
+
+bool ButtonManager::pollEvent(ButtonEvent& event) {
+    return eventQueue.pop(event);
+}
+
+uint32_t ButtonManager::getEventOverflowCount() {
+    return eventQueue.getOverflowCount();
+}
+
+bool ButtonManager::waitForInput(uint32_t timeoutMs) {
+    return edgeCapture.waitForEdge(timeoutMs);
+}
+
+bool ButtonManager::isButtonPressed(uint8_t index) {
+#if BUTTON_BATCH_SCAN
+    return (debouncer.getPressedMask() >> index) & 0x1;
+#else
+    return buttons[index].isPressed();
+#endif
+}
+
+bool ButtonManager::isButtonLongPressed(uint8_t index) {
+#if BUTTON_BATCH_SCAN
+    return (debouncer.getLongPressedMask() >> index) & 0x1;
+#else
+    return buttons[index].isLongPressed();
+#endif
 }
 
 bool ButtonManager::isPairingCombo() {
     // Button 1 and Button 2 pressed simultaneously
-    return buttons[0].isPressed() && buttons[1].isPressed();
+    return isButtonPressed(0) && isButtonPressed(1);
 }
 
 bool ButtonManager::isFactoryResetCombo() {
     // Button 5 and Button 6 long pressed simultaneously
-    return buttons[4].isLongPressed() && buttons[5].isLongPressed();
+    return isButtonLongPressed(4) && isButtonLongPressed(5);
 }
 
 bool ButtonManager::isChannelUpCombo() {
     // Button 5 long press (when not combined with button 6)
-    return buttons[4].isLongPressed() && !buttons[5].isPressed();
+    return isButtonLongPressed(4) && !isButtonPressed(5);
 }
 
 bool ButtonManager::isChannelDownCombo() {
     // Button 6 long press (when not combined with button 5)
-    return buttons[5].isLongPressed() && !buttons[4].isPressed();
-}
\ No newline at end of file
+    return isButtonLongPressed(5) && !isButtonPressed(4);
+}
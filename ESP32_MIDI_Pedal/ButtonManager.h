@@ -8,20 +8,46 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include <EdgeCapture.h>
+#include "VerticalDebouncer.h"
+
+// Fixed-capacity event queue, kept in timestamp order
+class ButtonEventQueue {
+public:
+    static const uint8_t CAPACITY = 16;
+
+private:
+    ButtonEvent events[CAPACITY];
+    uint8_t head;
+    uint8_t count;
+    uint32_t overflowCount;
+    
+public:
+    ButtonEventQueue();
+    bool push(const ButtonEvent& event);
+    bool pop(ButtonEvent& event);
+    uint8_t size();
+    uint32_t getOverflowCount();
+};
 
 class Button {
 private:
     uint8_t pin;
-    bool lastState;
-    bool currentState;
-    unsigned long lastDebounceTime;
-    unsigned long pressStartTime;
+    uint8_t number;        // 1-based, as reported in ButtonEvent
+    bool lastState;        // Level after the last raw edge
+    bool currentState;     // Debounced level
+    int64_t lastEdgeUs;    // Timestamp of the last raw edge
+    int64_t pressStartUs;  // Timestamp of the debounced press edge
     bool longPressTriggered;
     
+    void pushEvent(ButtonEventQueue& queue, ButtonEventType type, int64_t timeUs);
+    
 public:
     Button();
-    void init(uint8_t buttonPin);
-    ButtonEvent update();
+    void init(uint8_t buttonPin, uint8_t buttonNumber);
+    void onEdge(bool level, int64_t timeUs, ButtonEventQueue& queue);
+    void syncLevel(bool level, int64_t timeUs, ButtonEventQueue& queue);
+    void update(int64_t nowUs, ButtonEventQueue& queue);
     bool isPressed();
     bool isLongPressed();
 };
@@ -29,6 +55,12 @@ public:
 class ButtonManager {
 private:
     Button buttons[BUTTON_COUNT];
+    EdgeCapture edgeCapture;
+    ButtonEventQueue eventQueue;
+    uint32_t reportedOverflows;
+    
+    // Batch path: all buttons debounced together, events as bitmasks
+    VerticalDebouncer debouncer;
     uint8_t buttonPins[BUTTON_COUNT] = {
         PIN_BUTTON_1, 
         PIN_BUTTON_2, 
@@ -38,10 +70,18 @@ private:
         PIN_BUTTON_6
     };
     
+    void updateBatch();
+    void pushMask(uint32_t mask, ButtonEventType type, unsigned long timestamp);
+    bool isButtonPressed(uint8_t index);
+    bool isButtonLongPressed(uint8_t index);
+    
 public:
     ButtonManager();
     void begin();
-    ButtonEvent update();
+    uint8_t update();
+    bool pollEvent(ButtonEvent& event);
+    uint32_t getEventOverflowCount();
+    bool waitForInput(uint32_t timeoutMs);
     bool isPairingCombo();
     bool isFactoryResetCombo();
     bool isChannelUpCombo();
@@ -64,10 +64,14 @@ DisplayManager::DisplayManager(LiquidCrystal_I2C* display) {
     lcd = display;
     messageTimer = 0;
     hasTemporaryMessage = false;
+    clearCanvas();
 }
 
 void DisplayManager::begin() {
     createCustomCharacters();
+    framebuffer.begin(lcd);
+    renderer.begin(sizeof(canvas), renderFrame, this, RENDER_DEADLINE_MS,
+                   RENDER_TASK_CORE, RENDER_TASK_PRIORITY);
 }
 
 void DisplayManager::createCustomCharacters() {
@@ -78,6 +82,37 @@ void DisplayManager::createCustomCharacters() {
     lcd->createChar(4, chargingIcon);
 }
 
+void DisplayManager::clearCanvas() {
+    memset(canvas, ' ', sizeof(canvas));
+}
+
+void DisplayManager::print(uint8_t col, uint8_t row, const char* text) {
+    // Clipped at the end of the line like the LCD shows it
+    while (*text && col < COLS) {
+        canvas[row * COLS + col++] = *text++;
+    }
+}
+
+void DisplayManager::put(uint8_t col, uint8_t row, uint8_t character) {
+    if (col < COLS && row < ROWS) {
+        canvas[row * COLS + col] = character;
+    }
+}
+
+void DisplayManager::present() {
+    renderer.publish(canvas);
+}
+
+void DisplayManager::renderFrame(const uint8_t* frame, void* context) {
+    // Render task, changed cells only and never clear(), so no flicker
+    DisplayManager* self = static_cast<DisplayManager*>(context);
+    self->framebuffer.setFrame(frame);
+    while (self->framebuffer.flushStep(LCD_FLUSH_STEP_CELLS)) {
+        // A newer screen carries on from what has reached the LCD
+        if (self->renderer.hasPendingFrame()) return;
+    }
+}
+
 void DisplayManager::updateDisplay(SystemState& state) {
     // Check if temporary message should be cleared
     if (hasTemporaryMessage && millis() - messageTimer > 2000) {
@@ -86,123 +121,138 @@ void DisplayManager::updateDisplay(SystemState& state) {
     }
     
     if (!hasTemporaryMessage) {
-        lcd->clear();
+        char text[COLS + 1];
+        clearCanvas();
         
         // Line 1: Channel and Status
-        lcd->setCursor(0, 0);
-        lcd->print("CH:");
-        if (state.midiChannel < 10) lcd->print("0");
-        lcd->print(state.midiChannel);
+        snprintf(text, sizeof(text), "CH:%02d", state.midiChannel);
+        print(0, 0, text);
         
         // Bluetooth status
-        lcd->setCursor(7, 0);
         if (state.isConnected) {
-            lcd->write(3);  // Bluetooth icon
-            lcd->print(" ON ");
+            put(7, 0, 3);  // Bluetooth icon
+            print(8, 0, " ON ");
         } else {
-            lcd->print("  OFF");
+            print(7, 0, "  OFF");
         }
         
         // Battery icon
-        lcd->setCursor(14, 0);
         if (state.isCharging) {
-            lcd->write(4);  // Charging icon
+            put(14, 0, 4);  // Charging icon
         } else if (state.batteryLevel > 60) {
-            lcd->write(0);  // Full battery
+            put(14, 0, 0);  // Full battery
         } else if (state.batteryLevel > 30) {
-            lcd->write(1);  // Half battery
+            put(14, 0, 1);  // Half battery
         } else {
-            lcd->write(2);  // Low battery
+            put(14, 0, 2);  // Low battery
         }
         
         // Battery percentage
-        lcd->setCursor(15, 0);
         if (state.batteryLevel == 100) {
-            lcd->print("F");
+            print(15, 0, "F");
         } else {
             // Don't show percentage, just icon
         }
         
         // Line 2: Status or Ready message
-        lcd->setCursor(0, 1);
         if (state.isPairingMode) {
-            lcd->print("Pairing Mode... ");
+            print(0, 1, "Pairing Mode... ");
         } else if (state.isConnected) {
-            lcd->print("Ready - 6xCC    ");
+            print(0, 1, "Ready - 6xCC    ");
         } else {
-            lcd->print("Not Connected   ");
+            print(0, 1, "Not Connected   ");
         }
+        present();
     }
 }
 
 void DisplayManager::showBootScreen() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("MIDI Pedal v1.0");
-    lcd->setCursor(0, 1);
-    lcd->print("Initializing... ");
-    delay(2000);
+    clearCanvas();
+    print(0, 0, "MIDI Pedal v1.0");
+    print(0, 1, "Initializing... ");
+    present();
 }
 
 void DisplayManager::showMidiSent(uint8_t ccNumber, uint8_t channel) {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("MIDI Sent:");
-    lcd->setCursor(0, 1);
-    lcd->print("CC#");
-    lcd->print(ccNumber);
-    lcd->print(" CH:");
-    lcd->print(channel);
-    lcd->print(" Val:127");
+    char text[COLS + 1];
+    clearCanvas();
+    print(0, 0, "MIDI Sent:");
+    snprintf(text, sizeof(text), "CC#%d CH:%d Val:127", ccNumber, channel);
+    print(0, 1, text);
+    present();
+    
+    hasTemporaryMessage = true;
+    messageTimer = millis();
+}
+
+void DisplayManager::showProgramChange(uint8_t program, uint8_t channel) {
+    char text[COLS + 1];
+    clearCanvas();
+    print(0, 0, "MIDI Received:");
+    snprintf(text, sizeof(text), "PC#%d CH:%d", program, channel);
+    print(0, 1, text);
+    present();
+    
+    hasTemporaryMessage = true;
+    messageTimer = millis();
+}
+
+void DisplayManager::showControlFeedback(uint8_t ccNumber, uint8_t value) {
+    char text[COLS + 1];
+    clearCanvas();
+    print(0, 0, "MIDI Received:");
+    snprintf(text, sizeof(text), "CC#%d Val:%d", ccNumber, value);
+    print(0, 1, text);
+    present();
     
     hasTemporaryMessage = true;
     messageTimer = millis();
 }
 
 void DisplayManager::showChannelChange(uint8_t channel) {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("Channel Changed:");
-    lcd->setCursor(0, 1);
-    lcd->print("    CH: ");
-    if (channel < 10) lcd->print("0");
-    lcd->print(channel);
-    lcd->print("    ");
+    char text[COLS + 1];
+    clearCanvas();
+    print(0, 0, "Channel Changed:");
+    snprintf(text, sizeof(text), "    CH: %02d    ", channel);
+    print(0, 1, text);
+    present();
     
     hasTemporaryMessage = true;
     messageTimer = millis();
 }
 
 void DisplayManager::showPairingMode() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("  PAIRING MODE  ");
-    lcd->setCursor(0, 1);
-    lcd->print("Discoverable... ");
+    clearCanvas();
+    print(0, 0, "  PAIRING MODE  ");
+    print(0, 1, "Discoverable... ");
+    present();
+    
+    hasTemporaryMessage = true;
+    messageTimer = millis();
 }
 
 void DisplayManager::showFactoryReset() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print(" FACTORY RESET  ");
-    lcd->setCursor(0, 1);
-    lcd->print("  Restarting... ");
+    clearCanvas();
+    print(0, 0, " FACTORY RESET  ");
+    print(0, 1, "  Restarting... ");
+    present();
+    
+    hasTemporaryMessage = true;
+    messageTimer = millis();
 }
 
 void DisplayManager::showSleepMode() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("  Sleep Mode    ");
-    lcd->setCursor(0, 1);
-    lcd->print("Press to wake   ");
+    clearCanvas();
+    print(0, 0, "  Sleep Mode    ");
+    print(0, 1, "Press to wake   ");
+    present();
 }
 
 void DisplayManager::showLowBattery() {
-    lcd->clear();
-    lcd->setCursor(0, 0);
-    lcd->print("!LOW BATTERY!   ");
-    lcd->setCursor(0, 1);
-    lcd->print("Please Charge   ");
+    clearCanvas();
+    print(0, 0, "!LOW BATTERY!   ");
+    print(0, 1, "Please Charge   ");
+    present();
     
     hasTemporaryMessage = true;
     messageTimer = millis();
@@ -210,4 +260,13 @@ void DisplayManager::showLowBattery() {
 
 void DisplayManager::clearTemporaryMessage() {
     hasTemporaryMessage = false;
-}
\ No newline at end of file
+}
+
+bool DisplayManager::waitIdle(uint32_t timeoutMs) {
+    return renderer.waitIdle(timeoutMs);
+}
+
+void DisplayManager::printStats() {
+    renderer.printStats();
+    framebuffer.printStats();
+}
@@ -1,6 +1,10 @@
 /*
  * Display Manager Module
  * Handles all LCD display operations
+ *
+ * Screens are composed into a 2x16 canvas and published to a render task
+ * on core 0, which does the I2C. Callers only pay for the compose, and
+ * the render task only sends the characters that changed.
  */
 
 #ifndef DISPLAY_MANAGER_H
@@ -9,16 +13,32 @@
 #include <Arduino.h>
 #include <LiquidCrystal_I2C.h>
 #include "config.h"
+#include "LcdFramebuffer.h"
+#include <RenderTask.h>
 
 class DisplayManager {
+public:
+    static const uint8_t COLS = LcdFramebuffer::COLS;
+    static const uint8_t ROWS = LcdFramebuffer::ROWS;
+
 private:
     LiquidCrystal_I2C* lcd;
+    LcdFramebuffer framebuffer;  // Render task only
+    RenderTask renderer;
+    uint8_t canvas[ROWS * COLS];  // Screen being composed, producer only
     unsigned long messageTimer;
     bool hasTemporaryMessage;
     
     // Custom characters for battery and BT icons
     void createCustomCharacters();
     
+    // Canvas drawing, present() hands the screen to the render task
+    void clearCanvas();
+    void print(uint8_t col, uint8_t row, const char* text);
+    void put(uint8_t col, uint8_t row, uint8_t character);
+    void present();
+    static void renderFrame(const uint8_t* frame, void* context);
+    
 public:
     DisplayManager(LiquidCrystal_I2C* display);
     void begin();
@@ -26,11 +46,15 @@ public:
     void showBootScreen();
     void showMidiSent(uint8_t ccNumber, uint8_t channel);
     void showChannelChange(uint8_t channel);
+    void showProgramChange(uint8_t program, uint8_t channel);
+    void showControlFeedback(uint8_t ccNumber, uint8_t value);
     void showPairingMode();
     void showFactoryReset();
     void showSleepMode();
     void showLowBattery();
     void clearTemporaryMessage();
+    bool waitIdle(uint32_t timeoutMs);  // Before touching the LCD directly
+    void printStats();
 };
 
 #endif
\ No newline at end of file
@@ -31,14 +31,72 @@
 #include "BatteryManager.h"
 #include "ConfigManager.h"
 
+// Shared with the PlatformIO firmware, from lib/
+#include <MidiParser.h>
+#include <ConnectionManager.h>
+#include <ReconnectManager.h>
+#include <TxPowerControl.h>
+#include <PowerManager.h>
+#include <BootProfiler.h>
+#include <Timeline.h>
+
 // Global objects
 LiquidCrystal_I2C lcd(LCD_ADDRESS, 16, 2);
 Preferences preferences;
 MidiHandler midiHandler;
+MidiParser midiParser;
 DisplayManager displayManager(&lcd);
 ButtonManager buttonManager;
 BatteryManager batteryManager;
 ConfigManager configManager(&preferences);
+ConnectionManager connectionManager;
+TxPowerControl txPowerControl;
+PowerManager powerManager;
+ReconnectManager reconnectManager;
+
+// Startup phase timings, LCD and config load run beside BLE init
+BootProfiler bootProfiler;
+SemaphoreHandle_t bootTaskDone = nullptr;
+
+// Advertising schedule after boot or disconnect, slower and quieter each step
+// Intervals in 0.625 ms units, duration 0 = until a host connects
+const AdvertisingStep advertisingSchedule[] = {
+    {"directed",  ADV_DIRECTED,  0x0006, 0x0006, ESP_PWR_LVL_P9, 1280},
+    {"whitelist", ADV_WHITELIST, 0x0020, 0x0030, ESP_PWR_LVL_P6, 10000},
+    {"fast",      ADV_OPEN,      0x0020, 0x0030, ESP_PWR_LVL_P6, 30000},   // 20-30 ms
+    {"medium",    ADV_OPEN,      0x00F4, 0x0110, ESP_PWR_LVL_P3, 120000},  // 152.5-170 ms
+    {"slow",      ADV_OPEN,      0x0664, 0x0800, ESP_PWR_LVL_N0, 0}        // 1022.5-1280 ms
+};
+
+// LED animations, stepped from loop() so buttons and MIDI stay live
+Timeline timeline;
+
+enum AnimationOutput {
+    ANIM_LED_POWER,
+    ANIM_LED_BLUETOOTH,
+    ANIM_LED_CHARGING
+};
+
+// Pairing: Bluetooth LED blinks 10 times
+const Keyframe pairingKeys[] = {{0, HIGH}, {200, LOW}};
+const TimelineTrack pairingTracks[] = {
+    {ANIM_LED_BLUETOOTH, pairingKeys, 2, 400}
+};
+const Animation pairingBlink = {"pairing", pairingTracks, 1, 4000};
+
+// Factory reset: all LEDs flash 3 times, then power LED only until the restart
+const Keyframe resetPowerKeys[] = {
+    {0, LOW}, {200, HIGH}, {400, LOW}, {600, HIGH}, {800, LOW}, {1000, HIGH}
+};
+const Keyframe resetOtherKeys[] = {
+    {0, LOW}, {200, HIGH}, {400, LOW}, {600, HIGH}, {800, LOW}, {1000, HIGH}, {1200, LOW}
+};
+const TimelineTrack resetTracks[] = {
+    {ANIM_LED_POWER,     resetPowerKeys, 6, 0},
+    {ANIM_LED_BLUETOOTH, resetOtherKeys, 7, 0},
+    {ANIM_LED_CHARGING,  resetOtherKeys, 7, 0}
+};
+const Animation resetFlash = {"factory reset", resetTracks, 3, 2000};
 
 // BLE objects
 BLEServer* pServer = nullptr;
@@ -56,7 +114,61 @@ SystemState systemState = {
     .lastActivity = 0
 };
 
+// Set once a combination has fired, cleared when it is let go
+bool pairingComboHandled = false;
+bool factoryResetComboHandled = false;
+
+// GATT server events not exposed by BLEServerCallbacks
+void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gatts_cb_param_t* param) {
+    switch (event) {
+        case ESP_GATTS_MTU_EVT:
+            midiHandler.setMtu(param->mtu.mtu);
+            Serial.printf("BLE MTU negotiated: %d\n", param->mtu.mtu);
+            break;
+        case ESP_GATTS_DISCONNECT_EVT:
+            connectionManager.onDisconnect();
+            txPowerControl.onDisconnect();
+            midiHandler.setMtu(23);  // Default ATT MTU until the next exchange
+            midiHandler.onDisconnect();
+            midiParser.reset();
+            break;
+        case ESP_GATTS_CONGEST_EVT:
+            midiHandler.onCongestion(param->congest.congested);
+            break;
+        case ESP_GATTS_CONF_EVT:
+            // Also sent for notifications, with the status of the L2CAP write
+            if (pCharacteristic && param->conf.handle == pCharacteristic->getHandle()) {
+                midiHandler.onNotifyResult(param->conf.status);
+                if (param->conf.status != ESP_GATT_OK && param->conf.status != ESP_GATT_CONGESTED) {
+                    txPowerControl.onLinkTrouble();
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// GAP events not exposed by the Arduino BLE classes
+void gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+    connectionManager.onGapEvent(event, param);
+    txPowerControl.onGapEvent(event, param);
+    reconnectManager.onGapEvent(event, param);
+}
+
 // BLE Callbacks
+class MidiCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* characteristic) {
+        // Runs in the BLE task, the parser does not allocate
+        midiParser.parse(characteristic->getData(), characteristic->getLength());
+    }
+    
+    // Synchronous notify() outcome, failures are retried by flush()
+    void onStatus(BLECharacteristic* characteristic, Status status, uint32_t code) {
+        midiHandler.onNotifyStatus(status);
+    }
+};
+
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
         deviceConnected = true;
@@ -65,52 +177,103 @@ class MyServerCallbacks: public BLEServerCallbacks {
         Serial.println("BLE Client Connected");
     }
 
+    // Ask for a short connection interval, the advertised one is only a hint
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+        connectionManager.onConnect(param);
+        txPowerControl.onConnect(param);
+        reconnectManager.onConnect();
+    }
+
     void onDisconnect(BLEServer* pServer) {
         deviceConnected = false;
         systemState.isConnected = false;
         digitalWrite(PIN_LED_BLUETOOTH, LOW);
         Serial.println("BLE Client Disconnected");
-        // Start advertising again
-        delay(500);
-        pServer->startAdvertising();
+        // Advertising restarts from loop(), directed at this host first
+        reconnectManager.onDisconnect();
     }
 };
 
 void setup() {
     Serial.begin(115200);
     Serial.println("ESP32 MIDI Pedal Starting...");
-    
-    // Initialize I2C for LCD
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+    bootProfiler.setBudgets(BOOT_ADVERTISING_BUDGET_MS, BOOT_READY_BUDGET_MS);
     
     // Initialize components
-    initializePins();
-    
-    // Initialize LCD
-    lcd.init();
-    lcd.backlight();
-    displayManager.showBootScreen();
-    
-    // Load configuration
-    configManager.begin();
-    systemState.midiChannel = configManager.getMidiChannel();
-    
-    // Initialize battery manager
-    batteryManager.begin();
+    {
+        BootPhase phase(bootProfiler, "Pins and buttons");
+        initializePins();
+        buttonManager.begin();
+    }
     
-    // Initialize button manager
-    buttonManager.begin();
+    // LCD, configuration and battery on the other core while BLE comes up here
+    bootTaskDone = xSemaphoreCreateBinary();
+    if (xTaskCreatePinnedToCore(bootTask, "boot", BOOT_TASK_STACK_SIZE, nullptr,
+                                BOOT_TASK_PRIORITY, nullptr, BOOT_TASK_CORE) != pdPASS) {
+        Serial.println("Boot task creation failed, loading in sequence");
+        initializePeripherals();
+        xSemaphoreGive(bootTaskDone);
+    }
     
     // Initialize BLE MIDI
-    initializeBLE();
+    {
+        BootPhase phase(bootProfiler, "BLE and advertising");
+        initializeBLE();
+    }
+    bootProfiler.markAdvertising();
+    
+    {
+        BootPhase phase(bootProfiler, "Power and MIDI");
+        // 80 MHz baseline, full speed around button events, MIDI and redraws
+        powerManager.begin(CPU_FREQ_MAX_MHZ, CPU_FREQ_MIN_MHZ, LIGHT_SLEEP_ENABLED);
+        
+        // Initialize MIDI handler with BLE characteristic
+        midiHandler.begin(pCharacteristic);
+    }
     
-    // Initialize MIDI handler with BLE characteristic
-    midiHandler.begin(pCharacteristic);
+    // Buttons go live once the configuration is in
+    {
+        BootPhase phase(bootProfiler, "Wait for boot task");
+        xSemaphoreTake(bootTaskDone, portMAX_DELAY);
+    }
+    systemState.midiChannel = configManager.getMidiChannel();
     
-    // Update display
+    // Update display, the boot screen stays up until here
     displayManager.updateDisplay(systemState);
+    timeline.begin(writeAnimationOutput);
     
+    bootProfiler.markReady();
     Serial.println("Setup complete!");
+    bootProfiler.printSummary();
+}
+
+void bootTask(void* arg) {
+    initializePeripherals();
+    xSemaphoreGive(bootTaskDone);
+    vTaskDelete(nullptr);
+}
+
+void initializePeripherals() {
+    {
+        BootPhase phase(bootProfiler, "LCD init");
+        
+        // Initialize I2C for LCD
+        Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+        lcd.init();
+        lcd.backlight();
+        displayManager.begin();
+        displayManager.showBootScreen();
+    }
+    
+    {
+        BootPhase phase(bootProfiler, "Config load");
+        configManager.begin();
+    }
+    
+    {
+        BootPhase phase(bootProfiler, "Battery sampling");
+        batteryManager.begin();
+    }
 }
 
 void loop() {
@@ -119,9 +282,26 @@ void loop() {
     systemState.batteryLevel = batteryManager.getBatteryPercentage();
     systemState.isCharging = batteryManager.isCharging();
     
-    // Process button events
-    ButtonEvent event = buttonManager.update();
-    handleButtonEvent(event);
+    // Process every button event from this scan, oldest first
+    buttonManager.update();
+    ButtonEvent event;
+    while (buttonManager.pollEvent(event)) {
+        PowerLock boost(powerManager);
+        handleButtonEvent(event);
+    }
+    
+    // Everything sent for this scan goes out as one notification
+    {
+        PowerLock boost(powerManager, !midiHandler.isIdle());
+        midiHandler.flush();
+    }
+    
+    // Messages received from the host since the last pass
+    MidiMessage message;
+    while (midiParser.pop(message)) {
+        PowerLock boost(powerManager);
+        handleMidiMessage(message);
+    }
     
     // Handle BLE connection changes
     if (deviceConnected != oldDeviceConnected) {
@@ -134,18 +314,29 @@ void loop() {
         displayManager.updateDisplay(systemState);
     }
     
-    // Update display periodically
+    // Update display periodically, drawn on the render task
     static unsigned long lastDisplayUpdate = 0;
     if (millis() - lastDisplayUpdate > 1000) {
         lastDisplayUpdate = millis();
         displayManager.updateDisplay(systemState);
     }
     
+    // Connection parameter retries and reconnect advertising phases
+    connectionManager.update();
+    txPowerControl.update();
+    reconnectManager.update();
+    
+    // Diagnostics over serial
+    handleSerialCommand();
+    
     // Check for inactivity and enter sleep mode
     checkSleepMode();
     
-    // Small delay to prevent watchdog issues
-    delay(10);
+    // Animation keyframes due by now
+    timeline.update(millis());
+    
+    // Small delay to prevent watchdog issues, cut short by any button edge
+    buttonManager.waitForInput(10);
 }
 
 void initializePins() {
@@ -167,6 +358,13 @@ void initializePins() {
 void initializeBLE() {
     // Create BLE Device
     BLEDevice::init(DEVICE_NAME);
+    BLEDevice::setMTU(BLE_MIDI_MTU);
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
+    BLEDevice::setCustomGapHandler(gapEventHandler);
+    connectionManager.begin(BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX,
+                            BLE_SLAVE_LATENCY, BLE_SUPERVISION_TIMEOUT);
+    BLEDevice::setPower(BLE_TX_POWER_MAX);  // Connections start at max, txPowerControl lowers it
+    txPowerControl.begin(BLE_TX_POWER_MIN, BLE_TX_POWER_MAX);
     
     // Create BLE Server
     pServer = BLEDevice::createServer();
@@ -187,6 +385,9 @@ void initializeBLE() {
     // Add descriptor
     pCharacteristic->addDescriptor(new BLE2902());
     
+    // Decode what the host writes (Program Change, CC feedback)
+    pCharacteristic->setCallbacks(new MidiCallbacks());
+    
     // Start the service
     pService->start();
     
@@ -195,8 +396,12 @@ void initializeBLE() {
     pAdvertising->addServiceUUID(BLEUUID(MIDI_SERVICE_UUID));
     pAdvertising->setScanResponse(true);
     pAdvertising->setMinPreferred(0x06);
-    pAdvertising->setMinPreferred(0x12);
-    BLEDevice::startAdvertising();
+    pAdvertising->setMaxPreferred(0x12);
+    
+    // Directed advertising at the bonded host first, then the slower schedule steps
+    reconnectManager.begin(pAdvertising, advertisingSchedule,
+                           sizeof(advertisingSchedule) / sizeof(advertisingSchedule[0]));
+    reconnectManager.start();
     
     Serial.println("BLE MIDI Service started, waiting for connections...");
 }
@@ -206,18 +411,31 @@ void handleButtonEvent(ButtonEvent event) {
     
     // Update last activity time
     systemState.lastActivity = millis();
+    reconnectManager.onActivity();
     
-    // Handle pairing mode (Button 1 + Button 2)
+    // Handle pairing mode (Button 1 + Button 2), once per hold on the
+    // press that completes it
     if (buttonManager.isPairingCombo()) {
-        enterPairingMode();
+        if (!pairingComboHandled && event.type == BUTTON_PRESS &&
+            (event.buttonNumber == 1 || event.buttonNumber == 2)) {
+            pairingComboHandled = true;
+            enterPairingMode();
+        }
         return;
     }
+    pairingComboHandled = false;
     
-    // Handle factory reset (Button 5 + Button 6 long press)
+    // Handle factory reset (Button 5 + Button 6 long press), once per hold
+    // on the long press that completes it
     if (buttonManager.isFactoryResetCombo()) {
-        performFactoryReset();
+        if (!factoryResetComboHandled && event.type == BUTTON_LONG_PRESS &&
+            (event.buttonNumber == 5 || event.buttonNumber == 6)) {
+            factoryResetComboHandled = true;
+            performFactoryReset();
+        }
         return;
     }
+    factoryResetComboHandled = false;
     
     // Handle button events based on button number
     switch (event.buttonNumber) {
@@ -230,7 +448,8 @@ void handleButtonEvent(ButtonEvent event) {
             // All buttons send MIDI CC on normal press
             if (event.type == BUTTON_PRESS && deviceConnected) {
                 uint8_t ccNumber = event.buttonNumber; // CC#1-6
-                midiHandler.sendControlChange(systemState.midiChannel, ccNumber, 127);
+                // Stamped with the physical press time, not the notify time
+                midiHandler.sendControlChange(systemState.midiChannel, ccNumber, 127, event.timestamp);
                 displayManager.showMidiSent(ccNumber, systemState.midiChannel);
             }
             // Buttons 5 and 6 also handle channel change on long press
@@ -253,24 +472,37 @@ void handleButtonEvent(ButtonEvent event) {
     }
 }
 
+void handleMidiMessage(const MidiMessage& message) {
+    // Only our channel, the DAW echoes state for every track
+    if (message.status >= 0xF0) return;
+    if ((message.status & 0x0F) != systemState.midiChannel - 1) return;
+    
+    switch (message.status & 0xF0) {
+        case 0xC0:
+            displayManager.showProgramChange(message.data1, systemState.midiChannel);
+            break;
+        case 0xB0:
+            displayManager.showControlFeedback(message.data1, message.data2);
+            break;
+        default:
+            break;
+    }
+}
+
 void enterPairingMode() {
     Serial.println("Entering pairing mode...");
     systemState.isPairingMode = true;
     
-    // Clear any existing bonds
-    // Note: ESP32 doesn't have a simple way to clear bonds in Arduino
-    // Restart advertising with a different name temporarily
+    // Accept a new host, existing bonds are kept (factory reset clears them)
+    reconnectManager.startPairing();
     
     displayManager.showPairingMode();
     
-    // Blink Bluetooth LED
-    for (int i = 0; i < 10; i++) {
-        digitalWrite(PIN_LED_BLUETOOTH, HIGH);
-        delay(200);
-        digitalWrite(PIN_LED_BLUETOOTH, LOW);
-        delay(200);
-    }
-    
+    // Blink Bluetooth LED, buttons and MIDI keep running meanwhile
+    timeline.play(pairingBlink, endPairingMode);
+}
+
+void endPairingMode() {
     systemState.isPairingMode = false;
     displayManager.updateDisplay(systemState);
 }
@@ -280,31 +512,68 @@ void performFactoryReset() {
     
     displayManager.showFactoryReset();
     
+    // Visual feedback, settings are reset when it ends
+    timeline.play(resetFlash, completeFactoryReset);
+}
+
+void completeFactoryReset() {
     // Reset all settings
     configManager.factoryReset();
+    reconnectManager.clearBonds();
     systemState.midiChannel = 1;
     
-    // Visual feedback
-    for (int i = 0; i < 3; i++) {
-        digitalWrite(PIN_LED_POWER, LOW);
-        digitalWrite(PIN_LED_BLUETOOTH, LOW);
-        digitalWrite(PIN_LED_CHARGING, LOW);
-        delay(200);
-        digitalWrite(PIN_LED_POWER, HIGH);
-        digitalWrite(PIN_LED_BLUETOOTH, HIGH);
-        digitalWrite(PIN_LED_CHARGING, HIGH);
-        delay(200);
-    }
-    
-    digitalWrite(PIN_LED_POWER, HIGH);
-    digitalWrite(PIN_LED_BLUETOOTH, LOW);
-    digitalWrite(PIN_LED_CHARGING, LOW);
-    
     // Restart
-    delay(1000);
     ESP.restart();
 }
 
+void writeAnimationOutput(uint8_t output, uint8_t value) {
+    // RELEASE puts each LED back to what it shows outside animations
+    switch (output) {
+        case ANIM_LED_POWER:
+            digitalWrite(PIN_LED_POWER, value == LOW ? LOW : HIGH);
+            break;
+        case ANIM_LED_BLUETOOTH:
+            if (value == Timeline::RELEASE) value = deviceConnected ? HIGH : LOW;
+            digitalWrite(PIN_LED_BLUETOOTH, value);
+            break;
+        case ANIM_LED_CHARGING:
+            if (value == Timeline::RELEASE) value = systemState.isCharging ? HIGH : LOW;
+            digitalWrite(PIN_LED_CHARGING, value);
+            break;
+    }
+}
+
+void handleSerialCommand() {
+    if (!Serial.available()) return;
+    
+    char command = Serial.read();
+    if (command == 's') {
+        midiHandler.printStats();
+        midiParser.printStats();
+        connectionManager.printStats();
+        txPowerControl.printStats();
+        reconnectManager.printStats();
+        powerManager.printStats();
+        timeline.printStats();
+        displayManager.printStats();
+    } else if (command == 'b') {
+        // Latency and estimated current under each CPU frequency policy
+        powerManager.runBenchmark(benchmarkWorkload, nullptr);
+    } else if (command == 'p') {
+        // Startup phase timings, time-to-advertising and time-to-ready
+        bootProfiler.printSummary();
+    }
+}
+
+void benchmarkWorkload(void* context) {
+    // One press worth of work without notifying: a CC packet and a redraw
+    static MidiPacketBuilder packet;
+    uint8_t cc[3] = {(uint8_t)(0xB0 | ((systemState.midiChannel - 1) & 0x0F)), MIDI_CC_BUTTON_1, 127};
+    packet.clear();
+    packet.add(MidiPacketBuilder::timestampFromMillis(millis()), cc, sizeof(cc));
+    displayManager.updateDisplay(systemState);
+}
+
 void checkSleepMode() {
     // Enter sleep mode after 5 minutes of inactivity
     if (millis() - systemState.lastActivity > SLEEP_TIMEOUT) {
@@ -317,8 +586,9 @@ void checkSleepMode() {
 void enterSleepMode() {
     Serial.println("Entering sleep mode...");
     
-    // Show sleep message
+    // Show sleep message, drawn before the backlight goes off
     displayManager.showSleepMode();
+    displayManager.waitIdle(RENDER_IDLE_TIMEOUT_MS);
     
     // Turn off all LEDs
     digitalWrite(PIN_LED_POWER, LOW);
@@ -328,8 +598,9 @@ void enterSleepMode() {
     // Turn off LCD backlight
     lcd.noBacklight();
     
-    // Configure wake up sources (any button press)
-    esp_sleep_enable_ext0_wakeup(GPIO_NUM_32, 0); // Wake on Button 1 press
+    // Wake source: ext0 on Button 1 only, the other buttons do not wake
+    // this build (the PlatformIO firmware wakes on any of them via the ULP)
+    esp_sleep_enable_ext0_wakeup(GPIO_NUM_32, 0);
     
     // Enter deep sleep
     esp_deep_sleep_start();
@@ -0,0 +1,77 @@
+/*
+ * LCD Framebuffer Module Implementation
+ */
+
+#include "LcdFramebuffer.h"
+#include <esp_timer.h>
+
+LcdFramebuffer::LcdFramebuffer() {
+    lcd = nullptr;
+    memset(shadow, ' ', sizeof(shadow));
+    memset(onLcd, ' ', sizeof(onLcd));
+    scanIndex = CELLS;
+    cursor = CURSOR_UNKNOWN;
+    frameCount = 0;
+    supersededCount = 0;
+    cellWriteCount = 0;
+    cellSkipCount = 0;
+    cursorMoveCount = 0;
+    busTimeUs = 0;
+}
+
+void LcdFramebuffer::begin(LiquidCrystal_I2C* display) {
+    lcd = display;
+    memset(shadow, ' ', sizeof(shadow));
+    memset(onLcd, ' ', sizeof(onLcd));
+    scanIndex = CELLS;
+    cursor = CURSOR_UNKNOWN;  // createChar() leaves it in CGRAM
+}
+
+void LcdFramebuffer::setFrame(const uint8_t frame[CELLS]) {
+    if (scanIndex < CELLS) {
+        supersededCount++;
+    }
+    frameCount++;
+    memcpy(shadow, frame, CELLS);
+    scanIndex = 0;
+}
+
+bool LcdFramebuffer::flushStep(uint8_t maxCells) {
+    if (!lcd || scanIndex >= CELLS) return false;
+
+    int64_t start = esp_timer_get_time();
+    uint8_t sent = 0;
+    while (scanIndex < CELLS && sent < maxCells) {
+        uint8_t i = scanIndex++;
+        if (shadow[i] == onLcd[i]) {
+            cellSkipCount++;
+            continue;
+        }
+
+        if (cursor != i) {
+            lcd->setCursor(i % COLS, i / COLS);
+            cursorMoveCount++;
+        }
+        lcd->write(shadow[i]);
+        onLcd[i] = shadow[i];
+        sent++;
+
+        // The address does not wrap from the end of line 1 to line 2
+        cursor = (i % COLS == COLS - 1) ? CURSOR_UNKNOWN : i + 1;
+    }
+    cellWriteCount += sent;
+    busTimeUs += esp_timer_get_time() - start;
+    return scanIndex < CELLS;
+}
+
+bool LcdFramebuffer::isFlushed() {
+    return scanIndex >= CELLS;
+}
+
+void LcdFramebuffer::printStats() {
+    Serial.printf("LCD: %lu frames (%lu superseded mid-flush), %lu cells sent, %lu unchanged, "
+                  "%lu cursor moves, %lu us on I2C\n",
+                  (unsigned long)frameCount, (unsigned long)supersededCount,
+                  (unsigned long)cellWriteCount, (unsigned long)cellSkipCount,
+                  (unsigned long)cursorMoveCount, (unsigned long)busTimeUs);
+}
@@ -0,0 +1,56 @@
+/*
+ * LCD Framebuffer Module
+ * Shadow buffer and diff flush for the 16x2 HD44780 over I2C
+ *
+ * A frame is compared cell by cell with what the LCD already shows, and
+ * only the changed cells are sent. The HD44780 moves its cursor right
+ * after each character, so a run of changed cells costs one setCursor()
+ * and one write per cell; the cursor is only moved when the next changed
+ * cell is not where it already is. clear() is never used.
+ *
+ * flushStep() sends at most a given number of cells, so a redraw can be
+ * spread over several steps and a newer frame can take over in between:
+ * it is diffed against what actually reached the LCD.
+ */
+
+#ifndef LCD_FRAMEBUFFER_H
+#define LCD_FRAMEBUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+class LcdFramebuffer {
+public:
+    static const uint8_t COLS = 16;
+    static const uint8_t ROWS = 2;
+    static const uint8_t CELLS = COLS * ROWS;
+
+private:
+    static const uint8_t CURSOR_UNKNOWN = 0xFF;
+
+    LiquidCrystal_I2C* lcd;
+    uint8_t shadow[CELLS];  // Frame being flushed
+    uint8_t onLcd[CELLS];   // Cells as last sent
+    uint8_t scanIndex;      // Next cell to compare, CELLS when done
+    uint8_t cursor;         // Cell the next write lands in
+
+    // Statistics
+    uint32_t frameCount;
+    uint32_t supersededCount;
+    uint32_t cellWriteCount;
+    uint32_t cellSkipCount;
+    uint32_t cursorMoveCount;
+    uint64_t busTimeUs;
+
+public:
+    LcdFramebuffer();
+    void begin(LiquidCrystal_I2C* display);  // LCD initialized and blank
+
+    void setFrame(const uint8_t frame[CELLS]);
+    bool flushStep(uint8_t maxCells);  // True while cells remain
+    bool isFlushed();
+
+    void printStats();
+};
+
+#endif
@@ -3,80 +3,152 @@
  */
 
 #include "MidiHandler.h"
+#include <esp_timer.h>
 
 MidiHandler::MidiHandler() {
     pCharacteristic = nullptr;
+    sysexSource = nullptr;
+    sysexContext = nullptr;
+    sysexData = nullptr;
+    sysexRemaining = 0;
+    sysexStarted = false;
+    sysexPayloadDone = false;
+    sysexPacketLength = 0;
+    sysexPacketPayload = 0;
+    sysexCancelRequested.store(false);
+    sysexMessageCount = 0;
+    sysexPacketCount = 0;
+    sysexByteCount = 0;
+    sysexAbortCount = 0;
+    droppedMessages = 0;
 }
 
 void MidiHandler::begin(BLECharacteristic* characteristic) {
     pCharacteristic = characteristic;
+    flowControl.begin(characteristic);
     Serial.println("MIDI Handler initialized");
 }
 
-void MidiHandler::sendMidiMessage(uint8_t* data, size_t length) {
-    if (pCharacteristic && length <= 5) {
-        pCharacteristic->setValue(data, length);
-        pCharacteristic->notify();
+void MidiHandler::setMtu(uint16_t mtu) {
+    flowControl.setMtu(mtu);
+}
+
+void MidiHandler::onCongestion(bool congested) {
+    flowControl.onCongestion(congested);
+}
+
+void MidiHandler::onNotifyResult(esp_gatt_status_t status) {
+    flowControl.onNotifyResult(status);
+}
+
+void MidiHandler::onNotifyStatus(BLECharacteristicCallbacks::Status status) {
+    flowControl.onNotifyStatus(status);
+}
+
+void MidiHandler::onDisconnect() {
+    flowControl.onDisconnect();
+    cancelSystemExclusive();
+}
+
+void MidiHandler::sendMidiMessage(const uint8_t* data, size_t length, unsigned long timestamp, bool continuous) {
+    MidiTxEvent event;
+    unsigned long eventMs = (timestamp == NOW) ? millis() : timestamp;
+    
+    memcpy(event.data, data, length);
+    event.length = length;
+    event.continuous = continuous;
+    event.timestamp = MidiPacketBuilder::timestampFromMillis(eventMs);
+    event.sourceUs = (int64_t)eventMs * 1000;
+    event.enqueueUs = esp_timer_get_time();
+    
+    // Held in the flow control backlog and coalesced until the link is free
+    if (!flowControl.push(event)) {
+        droppedMessages++;
+        Serial.println("MIDI backlog full, message dropped");
+    }
+}
+
+void MidiHandler::flush() {
+    int64_t now = esp_timer_get_time();
+    takeSysExCancel();
+    flowControl.update(now);
+    
+    // Channel messages go out between SysEx messages, never inside one
+    if (!sysexStarted) {
+        flowControl.sendBacklog(now);
+    }
+    
+    // Pace SysEx so the loop keeps scanning buttons during a large dump. A
+    // new SysEx waits until the messages queued before it are out.
+    for (int i = 0; i < SYSEX_PACKETS_PER_FLUSH && isSysExBusy(); i++) {
+        flowControl.update(now);
+        if (!flowControl.canSend()) break;
+        if (!sysexStarted && flowControl.getBacklog() > 0) break;
+        sendSysExPacket(now);
     }
 }
 
-void MidiHandler::sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) {
+void MidiHandler::printStats() {
+    flowControl.printStats();
+    Serial.printf("SysEx: %lu messages, %lu packets, %lu bytes, %lu aborted (invalid byte), "
+                  "%lu messages dropped (backlog full)\n",
+                  (unsigned long)sysexMessageCount, (unsigned long)sysexPacketCount,
+                  (unsigned long)sysexByteCount, (unsigned long)sysexAbortCount,
+                  (unsigned long)droppedMessages);
+}
+
+void MidiHandler::sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, unsigned long timestamp) {
     if (channel < 1 || channel > 16) return;
     
-    midiPacket[0] = 0x80;  // Header
-    midiPacket[1] = 0x80;  // Timestamp (not used)
-    midiPacket[2] = 0x90 | (channel - 1);  // Note On + channel
-    midiPacket[3] = note & 0x7F;
-    midiPacket[4] = velocity & 0x7F;
+    uint8_t message[3];
+    message[0] = 0x90 | (channel - 1);  // Note On + channel
+    message[1] = note & 0x7F;
+    message[2] = velocity & 0x7F;
     
-    sendMidiMessage(midiPacket, 5);
+    sendMidiMessage(message, 3, timestamp, false);
     
     Serial.printf("MIDI Note On - Ch:%d Note:%d Vel:%d\n", channel, note, velocity);
 }
 
-void MidiHandler::sendNoteOff(uint8_t channel, uint8_t note, uint8_t velocity) {
+void MidiHandler::sendNoteOff(uint8_t channel, uint8_t note, uint8_t velocity, unsigned long timestamp) {
     if (channel < 1 || channel > 16) return;
     
-    midiPacket[0] = 0x80;  // Header
-    midiPacket[1] = 0x80;  // Timestamp
-    midiPacket[2] = 0x80 | (channel - 1);  // Note Off + channel
-    midiPacket[3] = note & 0x7F;
-    midiPacket[4] = velocity & 0x7F;
+    uint8_t message[3];
+    message[0] = 0x80 | (channel - 1);  // Note Off + channel
+    message[1] = note & 0x7F;
+    message[2] = velocity & 0x7F;
     
-    sendMidiMessage(midiPacket, 5);
+    sendMidiMessage(message, 3, timestamp, false);
     
     Serial.printf("MIDI Note Off - Ch:%d Note:%d Vel:%d\n", channel, note, velocity);
 }
 
-void MidiHandler::sendControlChange(uint8_t channel, uint8_t control, uint8_t value) {
+void MidiHandler::sendControlChange(uint8_t channel, uint8_t control, uint8_t value, unsigned long timestamp) {
     if (channel < 1 || channel > 16) return;
     
-    midiPacket[0] = 0x80;  // Header
-    midiPacket[1] = 0x80;  // Timestamp
-    midiPacket[2] = 0xB0 | (channel - 1);  // Control Change + channel
-    midiPacket[3] = control & 0x7F;
-    midiPacket[4] = value & 0x7F;
+    uint8_t message[3];
+    message[0] = 0xB0 | (channel - 1);  // Control Change + channel
+    message[1] = control & 0x7F;
+    message[2] = value & 0x7F;
     
-    sendMidiMessage(midiPacket, 5);
+    sendMidiMessage(message, 3, timestamp, false);
     
     Serial.printf("MIDI CC - Ch:%d CC#%d Val:%d\n", channel, control, value);
 }
 
-void MidiHandler::sendProgramChange(uint8_t channel, uint8_t program) {
+void MidiHandler::sendProgramChange(uint8_t channel, uint8_t program, unsigned long timestamp) {
     if (channel < 1 || channel > 16) return;
     
-    midiPacket[0] = 0x80;  // Header
-    midiPacket[1] = 0x80;  // Timestamp
-    midiPacket[2] = 0xC0 | (channel - 1);  // Program Change + channel
-    midiPacket[3] = program & 0x7F;
-    midiPacket[4] = 0;  // Not used for program change
+    uint8_t message[2];
+    message[0] = 0xC0 | (channel - 1);  // Program Change + channel
+    message[1] = program & 0x7F;
     
-    sendMidiMessage(midiPacket, 4);
+    sendMidiMessage(message, 2, timestamp, false);
     
     Serial.printf("MIDI Program Change - Ch:%d Prog:%d\n", channel, program);
 }
 
-void MidiHandler::sendPitchBend(uint8_t channel, int16_t bend) {
+void MidiHandler::sendPitchBend(uint8_t channel, int16_t bend, unsigned long timestamp) {
     if (channel < 1 || channel > 16) return;
     
     // Convert bend value to 14-bit MIDI format
@@ -84,23 +156,152 @@ void MidiHandler::sendPitchBend(uint8_t channel, int16_t bend) {
     uint8_t lsb = bendValue & 0x7F;
     uint8_t msb = (bendValue >> 7) & 0x7F;
     
-    midiPacket[0] = 0x80;  // Header
-    midiPacket[1] = 0x80;  // Timestamp
-    midiPacket[2] = 0xE0 | (channel - 1);  // Pitch Bend + channel
-    midiPacket[3] = lsb;
-    midiPacket[4] = msb;
+    uint8_t message[3];
+    message[0] = 0xE0 | (channel - 1);  // Pitch Bend + channel
+    message[1] = lsb;
+    message[2] = msb;
     
-    sendMidiMessage(midiPacket, 5);
+    // Only the latest bend value matters when the link is backed up
+    sendMidiMessage(message, 3, timestamp, true);
     
     Serial.printf("MIDI Pitch Bend - Ch:%d Bend:%d\n", channel, bend);
 }
 
-void MidiHandler::sendSystemExclusive(uint8_t* data, size_t length) {
-    // For SysEx messages, we need to send them in chunks
-    // This is a simplified implementation
-    // Full implementation would require proper chunking
-    
+bool MidiHandler::sendSystemExclusive(const uint8_t* data, size_t length) {
+    // Accept the message with or without its F0/F7 framing
     if (length > 0 && data[0] == 0xF0) {
-        Serial.println("SysEx messages not fully implemented in this version");
+        data++;
+        length--;
     }
-}
\ No newline at end of file
+    if (length > 0 && data[length - 1] == 0xF7) {
+        length--;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] & 0x80) {
+            Serial.printf("SysEx rejected: status byte 0x%02X at offset %u\n", data[i], (unsigned)i);
+            return false;
+        }
+    }
+    
+    takeSysExCancel();
+    if (isSysExBusy()) return false;
+    sysexData = data;
+    sysexRemaining = length;
+    return sendSystemExclusive(readSysExBuffer, this);
+}
+
+bool MidiHandler::sendSystemExclusive(SysExSource source, void* context) {
+    takeSysExCancel();
+    if (isSysExBusy() || !source || !pCharacteristic) return false;
+    
+    sysexSource = source;
+    sysexContext = context;
+    sysexStarted = false;
+    sysexPayloadDone = false;
+    sysexPacketLength = 0;
+    sysexMessageCount++;
+    return true;
+}
+
+bool MidiHandler::isSysExBusy() {
+    return sysexSource != nullptr;
+}
+
+bool MidiHandler::isIdle() {
+    return flowControl.isIdle() && !isSysExBusy();
+}
+
+void MidiHandler::cancelSystemExclusive() {
+    // The loop may be inside sendSysExPacket(), it clears the state itself
+    sysexCancelRequested.store(true);
+}
+
+void MidiHandler::takeSysExCancel() {
+    if (sysexCancelRequested.exchange(false)) {
+        clearSystemExclusive();
+    }
+}
+
+void MidiHandler::clearSystemExclusive() {
+    // The receiver drops the partial message on disconnect, nothing to close
+    sysexSource = nullptr;
+    sysexData = nullptr;
+    sysexRemaining = 0;
+    sysexStarted = false;
+    sysexPayloadDone = false;
+    sysexPacketLength = 0;
+    sysexPacketPayload = 0;
+}
+
+size_t MidiHandler::readSysExBuffer(uint8_t* dest, size_t maxLength, void* context) {
+    MidiHandler* handler = (MidiHandler*)context;
+    size_t count = handler->sysexRemaining < maxLength ? handler->sysexRemaining : maxLength;
+    
+    memcpy(dest, handler->sysexData, count);
+    handler->sysexData += count;
+    handler->sysexRemaining -= count;
+    return count;
+}
+
+void MidiHandler::buildSysExPacket() {
+    // Packet layouts (BLE-MIDI spec):
+    //   first:        header, timestamp, F0, data...
+    //   continuation: header, data...
+    //   last:         header, data..., timestamp, F7
+    // Two bytes are always kept free so the end marker fits whenever the
+    // source runs dry.
+    uint16_t maxSize = flowControl.getMaxPacketSize();
+    uint16_t timestamp = MidiPacketBuilder::timestampFromMillis(millis());
+    size_t length = 0;
+    
+    sysexPacket[length++] = 0x80 | ((timestamp >> 7) & 0x3F);
+    if (!sysexStarted) {
+        sysexPacket[length++] = 0x80 | (timestamp & 0x7F);
+        sysexPacket[length++] = 0xF0;
+    }
+    
+    size_t room = maxSize - length - 2;
+    size_t count = sysexSource(&sysexPacket[length], room, sysexContext);
+    sysexPayloadDone = (count < room);
+    
+    // A status byte would end the message early on the receiver side. Send
+    // what came before it and close the message here.
+    for (size_t i = 0; i < count; i++) {
+        if (sysexPacket[length + i] & 0x80) {
+            Serial.printf("SysEx aborted: status byte 0x%02X in the source data\n", sysexPacket[length + i]);
+            sysexAbortCount++;
+            count = i;
+            sysexPayloadDone = true;
+            break;
+        }
+    }
+    length += count;
+    sysexPacketPayload = count;
+    
+    if (sysexPayloadDone) {
+        sysexPacket[length++] = 0x80 | (timestamp & 0x7F);
+        sysexPacket[length++] = 0xF7;
+    }
+    sysexPacketLength = length;
+}
+
+void MidiHandler::sendSysExPacket(int64_t nowUs) {
+    // The source has already moved past the bytes of a packet flow control
+    // refused, so that packet is kept and offered again unchanged
+    if (sysexPacketLength == 0) {
+        buildSysExPacket();
+    }
+    
+    // Kept in sysexPacket until flow control has it confirmed or retried
+    if (!flowControl.send(sysexPacket, sysexPacketLength, nowUs)) return;
+    
+    sysexStarted = true;
+    sysexPacketCount++;
+    sysexByteCount += sysexPacketPayload;
+    sysexPacketLength = 0;
+    
+    if (sysexPayloadDone) {
+        clearSystemExclusive();
+    }
+}
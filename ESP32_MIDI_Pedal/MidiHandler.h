@@ -8,23 +8,78 @@
 
 #include <Arduino.h>
 #include <BLECharacteristic.h>
+#include <atomic>
+#include "config.h"
+#include <MidiFlowControl.h>
+
+// Fills dest with up to maxLength SysEx data bytes (no F0/F7) and returns
+// how many were written. Returning less than maxLength ends the message.
+typedef size_t (*SysExSource)(uint8_t* dest, size_t maxLength, void* context);
 
 class MidiHandler {
 private:
     BLECharacteristic* pCharacteristic;
-    uint8_t midiPacket[5];
+    MidiFlowControl flowControl;
+    
+    // Streaming SysEx state, one message in flight at a time
+    SysExSource sysexSource;
+    void* sysexContext;
+    const uint8_t* sysexData;   // Caller buffer when streaming from memory
+    size_t sysexRemaining;
+    bool sysexStarted;          // F0 sent, the receiver is inside the message
+    bool sysexPayloadDone;      // Only the timestamp + F7 are left
+    uint8_t sysexPacket[MidiPacketBuilder::MAX_PACKET_SIZE];
+    uint16_t sysexPacketLength; // Built but not yet taken by flow control
+    size_t sysexPacketPayload;
+    std::atomic<bool> sysexCancelRequested;  // Set from any task
     
-    void sendMidiMessage(uint8_t* data, size_t length);
+    // Statistics
+    uint32_t sysexMessageCount;
+    uint32_t sysexPacketCount;
+    uint32_t sysexByteCount;
+    uint32_t sysexAbortCount;
+    uint32_t droppedMessages;
+    
+    void sendMidiMessage(const uint8_t* data, size_t length, unsigned long timestamp, bool continuous);
+    void buildSysExPacket();
+    void sendSysExPacket(int64_t nowUs);
+    void takeSysExCancel();
+    void clearSystemExclusive();
+    static size_t readSysExBuffer(uint8_t* dest, size_t maxLength, void* context);
     
 public:
+    static const unsigned long NOW = 0xFFFFFFFF;  // Timestamp taken at send time
+    
     MidiHandler();
     void begin(BLECharacteristic* characteristic);
-    void sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity);
-    void sendNoteOff(uint8_t channel, uint8_t note, uint8_t velocity);
-    void sendControlChange(uint8_t channel, uint8_t control, uint8_t value);
-    void sendProgramChange(uint8_t channel, uint8_t program);
-    void sendPitchBend(uint8_t channel, int16_t bend);
-    void sendSystemExclusive(uint8_t* data, size_t length);
+    void setMtu(uint16_t mtu);
+    void flush();
+    void printStats();
+    
+    // GATT events, called from the BLE task
+    void onCongestion(bool congested);
+    void onNotifyResult(esp_gatt_status_t status);
+    void onNotifyStatus(BLECharacteristicCallbacks::Status status);
+    void onDisconnect();
+    
+    // timestamp: millis() when the event happened, e.g. ButtonEvent::timestamp
+    void sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity, unsigned long timestamp = NOW);
+    void sendNoteOff(uint8_t channel, uint8_t note, uint8_t velocity, unsigned long timestamp = NOW);
+    void sendControlChange(uint8_t channel, uint8_t control, uint8_t value, unsigned long timestamp = NOW);
+    void sendProgramChange(uint8_t channel, uint8_t program, unsigned long timestamp = NOW);
+    void sendPitchBend(uint8_t channel, int16_t bend, unsigned long timestamp = NOW);
+    
+    // SysEx is streamed by flush() a few packets per call. The buffer is not
+    // copied and must stay valid until isSysExBusy() returns false. A data
+    // byte with bit 7 set from a SysExSource aborts the transfer: the bytes
+    // before it go out and the message is closed with F7.
+    // cancelSystemExclusive() may be called from any task; the transfer
+    // stops at the next flush() or sendSystemExclusive().
+    bool sendSystemExclusive(const uint8_t* data, size_t length);
+    bool sendSystemExclusive(SysExSource source, void* context);
+    bool isSysExBusy();
+    bool isIdle();
+    void cancelSystemExclusive();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Vertical Debouncer Module Implementation
+ */
+
+#include "VerticalDebouncer.h"
+#include <soc/gpio_reg.h>
+
+VerticalDebouncer::VerticalDebouncer() {
+    inputCount = 0;
+    pinMask = 0;
+    state = 0;
+    longMask = 0;
+    settleSamples = 1;
+    holdSamples = 1;
+    pressBits = 0;
+    releaseBits = 0;
+    longPressBits = 0;
+    samplePeriod = 10;
+    lastRaw = 0;
+    lastSampleTime = 0;
+    scanCount = 0;
+    
+    for (int i = 0; i < DEBOUNCE_BITS; i++) {
+        quietCount[i] = 0;
+    }
+    for (int i = 0; i < HOLD_BITS; i++) {
+        holdCount[i] = 0;
+    }
+}
+
+void VerticalDebouncer::begin(const uint8_t* inputPins, uint8_t count, uint16_t samplePeriodMs,
+                              uint16_t debounceMs, uint16_t longPressMs) {
+    if (count > MAX_INPUTS) count = MAX_INPUTS;
+    inputCount = count;
+    pinMask = 0;
+    for (uint8_t i = 0; i < inputCount; i++) {
+        pins[i] = inputPins[i];
+        pinMask |= (1ULL << pins[i]);
+    }
+    
+    // Same timing as Button::update() scanned every samplePeriodMs: a level
+    // is settled on the first sample more than debounceMs after it changed,
+    // long press fires longPressMs after the press edge, which is
+    // settleSamples before the debounced press
+    samplePeriod = samplePeriodMs > 0 ? samplePeriodMs : 1;
+    settleSamples = constrain(debounceMs / samplePeriod + 1, 1, (1 << DEBOUNCE_BITS) - 1);
+    int longSamples = (longPressMs + samplePeriod - 1) / samplePeriod - settleSamples;
+    holdSamples = constrain(longSamples, 1, (1 << HOLD_BITS) - 1);
+    
+    // Buttons already held at boot are pressed without an event
+    state = ~readInputs() & pinMask;
+    lastRaw = state;
+    lastSampleTime = millis();
+    
+    Serial.printf("Vertical debouncer initialized: %d inputs, %d/%d samples\n",
+                  inputCount, settleSamples, holdSamples);
+}
+
+uint64_t VerticalDebouncer::readInputs() {
+    // One read per register for every GPIO, pins 32-39 live in GPIO_IN1_REG
+    return ((uint64_t)REG_READ(GPIO_IN1_REG) << 32) | REG_READ(GPIO_IN_REG);
+}
+
+uint64_t VerticalDebouncer::matchCount(const uint64_t* planes, uint8_t bits, uint8_t value) {
+    uint64_t match = ~0ULL;
+    for (uint8_t k = 0; k < bits; k++) {
+        match &= ((value >> k) & 0x1) ? planes[k] : ~planes[k];
+    }
+    return match;
+}
+
+bool VerticalDebouncer::update(unsigned long now) {
+    unsigned long elapsed = now - lastSampleTime;
+    if (elapsed >= samplePeriod) {
+        // Periods missed while the loop was busy replay the same reading, capped
+        // to what any counter can still use
+        unsigned long samples = elapsed / samplePeriod;
+        lastSampleTime += samples * samplePeriod;
+        unsigned long maxSamples = (unsigned long)settleSamples + holdSamples;
+        if (samples > maxSamples) samples = maxSamples;
+        
+        uint64_t active = ~readInputs() & pinMask;  // Active low (INPUT_PULLUP)
+        while (samples--) {
+            processSample(active);
+        }
+    }
+    return (pressBits | releaseBits | longPressBits) != 0;
+}
+
+void VerticalDebouncer::processSample(uint64_t activeBits) {
+    scanCount++;
+    activeBits &= pinMask;
+    
+    // Samples the previous level has held up to now, saturating once settled
+    uint64_t previous = lastRaw;
+    uint64_t changed = activeBits ^ previous;
+    lastRaw = activeBits;
+    uint64_t carry = ~matchCount(quietCount, DEBOUNCE_BITS, settleSamples);
+    for (uint8_t k = 0; k < DEBOUNCE_BITS; k++) {
+        uint64_t c = quietCount[k];
+        quietCount[k] = c ^ carry;
+        carry &= c;
+    }
+    uint64_t settled = matchCount(quietCount, DEBOUNCE_BITS, settleSamples);
+    
+    // Settled lanes that disagree with the debounced state flip. Like
+    // Button::onEdge(), a level that held long enough counts even if it
+    // changes on this very sample.
+    uint64_t toggle = settled & (previous ^ state);
+    state ^= toggle;
+    
+    // A change restarts the count for the new level
+    for (uint8_t k = 0; k < DEBOUNCE_BITS; k++) {
+        quietCount[k] &= ~changed;
+    }
+    
+    uint64_t pressed = toggle & state;
+    uint64_t released = toggle & ~state;
+    pressBits |= pressed;
+    releaseBits |= released & ~longMask;  // No release event after a long press
+    longMask &= state;
+    
+    // Samples since the debounced press, saturating at the long press threshold
+    uint64_t holding = state & ~pressed;
+    uint64_t holdReached = matchCount(holdCount, HOLD_BITS, holdSamples);
+    carry = holding & ~holdReached;
+    for (uint8_t k = 0; k < HOLD_BITS; k++) {
+        uint64_t c = holdCount[k];
+        holdCount[k] = (c ^ carry) & holding;
+        carry &= c;
+    }
+    holdReached = holding & matchCount(holdCount, HOLD_BITS, holdSamples);
+    
+    // Like Button::update(), a long press is only reported while the switch
+    // reads closed, before or after this sample's edge
+    uint64_t longPressed = holdReached & (previous | activeBits) & ~longMask;
+    longMask |= longPressed;
+    longPressBits |= longPressed;
+}
+
+uint32_t VerticalDebouncer::toButtonMask(uint64_t bits) {
+    uint32_t mask = 0;
+    if (bits == 0) return 0;
+    for (uint8_t i = 0; i < inputCount; i++) {
+        if ((bits >> pins[i]) & 0x1) {
+            mask |= (1UL << i);
+        }
+    }
+    return mask;
+}
+
+uint32_t VerticalDebouncer::takePressed() {
+    uint32_t mask = toButtonMask(pressBits);
+    pressBits = 0;
+    return mask;
+}
+
+uint32_t VerticalDebouncer::takeReleased() {
+    uint32_t mask = toButtonMask(releaseBits);
+    releaseBits = 0;
+    return mask;
+}
+
+uint32_t VerticalDebouncer::takeLongPressed() {
+    uint32_t mask = toButtonMask(longPressBits);
+    longPressBits = 0;
+    return mask;
+}
+
+uint32_t VerticalDebouncer::getPressedMask() {
+    return toButtonMask(state);
+}
+
+uint32_t VerticalDebouncer::getLongPressedMask() {
+    return toButtonMask(state & longMask);
+}
+
+uint32_t VerticalDebouncer::getScanCount() {
+    return scanCount;
+}
@@ -0,0 +1,64 @@
+/*
+ * Vertical Debouncer Module
+ * Bit-parallel debouncing of all buttons from a single GPIO register read
+ *
+ * Every GPIO is a lane of a 64-bit word. Settle and long press counters
+ * are stored "vertically" (one word per counter bit), so a scan costs the
+ * same handful of bitwise operations whatever the number of buttons.
+ */
+
+#ifndef VERTICAL_DEBOUNCER_H
+#define VERTICAL_DEBOUNCER_H
+
+#include <Arduino.h>
+
+class VerticalDebouncer {
+public:
+    static const uint8_t MAX_INPUTS = 32;
+    static const uint8_t DEBOUNCE_BITS = 4;  // Up to 15 samples
+    static const uint8_t HOLD_BITS = 8;      // Up to 255 samples
+
+private:
+    uint8_t pins[MAX_INPUTS];
+    uint8_t inputCount;
+    uint64_t pinMask;
+    
+    uint64_t lastRaw;                    // Previous sample, 1 = active
+    uint64_t state;                      // Debounced, 1 = pressed
+    uint64_t longMask;                   // Long press already reported
+    uint64_t quietCount[DEBOUNCE_BITS];  // Samples since the lane last changed
+    uint64_t holdCount[HOLD_BITS];       // Samples since the debounced press
+    uint8_t settleSamples;
+    uint8_t holdSamples;
+    
+    // Pending events, in pin space
+    uint64_t pressBits;
+    uint64_t releaseBits;
+    uint64_t longPressBits;
+    
+    uint16_t samplePeriod;
+    unsigned long lastSampleTime;
+    uint32_t scanCount;
+    
+    static uint64_t readInputs();
+    static uint64_t matchCount(const uint64_t* planes, uint8_t bits, uint8_t value);
+    uint32_t toButtonMask(uint64_t bits);
+    
+public:
+    VerticalDebouncer();
+    void begin(const uint8_t* inputPins, uint8_t count, uint16_t samplePeriodMs,
+               uint16_t debounceMs, uint16_t longPressMs);
+    bool update(unsigned long now);
+    void processSample(uint64_t activeBits);
+    
+    // Event masks since the last call, bit i = input i
+    uint32_t takePressed();
+    uint32_t takeReleased();
+    uint32_t takeLongPressed();
+    
+    uint32_t getPressedMask();
+    uint32_t getLongPressedMask();
+    uint32_t getScanCount();
+};
+
+#endif
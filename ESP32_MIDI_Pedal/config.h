@@ -31,6 +31,8 @@
 #define DEBOUNCE_DELAY 50
 #define LONG_PRESS_TIME 1000
 #define BUTTON_COUNT 6
+#define BUTTON_BATCH_SCAN 0      // 1 = one GPIO register read + vertical counter debounce
+#define BUTTON_SAMPLE_PERIOD 10  // ms between batch scans
 
 // MIDI Configuration
 #define DEFAULT_MIDI_CHANNEL 1
@@ -40,10 +42,18 @@
 #define MIDI_CC_BUTTON_4 4
 #define MIDI_CC_BUTTON_5 5
 #define MIDI_CC_BUTTON_6 6
+#define SYSEX_PACKETS_PER_FLUSH 2  // SysEx notifications sent per loop pass
 
 // BLE MIDI UUIDs
 #define MIDI_SERVICE_UUID "03B80E5A-EDE8-4B33-A751-6CE34EC4C700"
 #define MIDI_CHARACTERISTIC_UUID "7772E5DB-3868-4112-A1A9-F2669D106BF3"
+#define BLE_MIDI_MTU 247  // Local ATT MTU offered to the central
+#define BLE_CONN_INTERVAL_MIN 6      // 7.5 ms (1.25 ms units)
+#define BLE_CONN_INTERVAL_MAX 12     // 15 ms
+#define BLE_SLAVE_LATENCY 0          // Never skip an event, a press must go out on the next one
+#define BLE_SUPERVISION_TIMEOUT 400  // 4 s (10 ms units)
+#define BLE_TX_POWER_MIN ESP_PWR_LVL_N12  // RSSI-driven range while connected
+#define BLE_TX_POWER_MAX ESP_PWR_LVL_P9
 
 // Battery Configuration
 #define BATTERY_MIN_VOLTAGE 3.0
@@ -55,6 +65,23 @@
 
 // Power Management
 #define SLEEP_TIMEOUT 300000  // 5 minutes in milliseconds
+#define CPU_FREQ_MAX_MHZ 240  // Hot paths only, under a PowerLock
+#define CPU_FREQ_MIN_MHZ 80   // Idle baseline
+#define LIGHT_SLEEP_ENABLED 0 // Frequency scaling only
+
+// Boot
+#define BOOT_TASK_CORE 0          // LCD, config and battery while setup() brings up BLE
+#define BOOT_TASK_PRIORITY 1
+#define BOOT_TASK_STACK_SIZE 4096
+#define BOOT_ADVERTISING_BUDGET_MS 600  // Regression limits for the BOOT summary line
+#define BOOT_READY_BUDGET_MS 700
+
+// Display
+#define RENDER_TASK_CORE 0        // LCD I2C off loop()'s core
+#define RENDER_TASK_PRIORITY 1
+#define RENDER_DEADLINE_MS 50     // A full 2x16 redraw over 100 kHz I2C takes ~20 ms
+#define LCD_FLUSH_STEP_CELLS 8    // Cells sent before checking for a newer frame
+#define RENDER_IDLE_TIMEOUT_MS 100
 
 // System State Structure
 struct SystemState {
@@ -0,0 +1,93 @@
+/*
+ * Boot Profiler Module Implementation
+ */
+
+#include "BootProfiler.h"
+#include <esp_timer.h>
+
+BootProfiler::BootProfiler() {
+    phaseCount.store(0);
+    advertisingUs = 0;
+    readyUs = 0;
+    advertisingBudgetMs = 0;
+    readyBudgetMs = 0;
+}
+
+void BootProfiler::setBudgets(uint32_t advertisingMs, uint32_t readyMs) {
+    advertisingBudgetMs = advertisingMs;
+    readyBudgetMs = readyMs;
+}
+
+uint8_t BootProfiler::beginPhase(const char* name) {
+    uint8_t index = phaseCount.fetch_add(1);
+    if (index >= MAX_PHASES) {
+        phaseCount.store(MAX_PHASES);
+        return NO_PHASE;
+    }
+
+    Phase& phase = phases[index];
+    phase.name = name;
+    phase.endUs = 0;
+    phase.core = (uint8_t)xPortGetCoreID();
+    phase.startUs = esp_timer_get_time();
+    return index;
+}
+
+void BootProfiler::endPhase(uint8_t index) {
+    if (index >= MAX_PHASES) return;
+    phases[index].endUs = esp_timer_get_time();
+}
+
+void BootProfiler::markAdvertising() {
+    advertisingUs = esp_timer_get_time();
+}
+
+void BootProfiler::markReady() {
+    readyUs = esp_timer_get_time();
+}
+
+int64_t BootProfiler::getTimeToAdvertisingUs() {
+    return advertisingUs;
+}
+
+int64_t BootProfiler::getTimeToReadyUs() {
+    return readyUs;
+}
+
+bool BootProfiler::isWithinBudget() {
+    if (advertisingUs == 0 || readyUs == 0) return false;
+    if (advertisingBudgetMs && advertisingUs > (int64_t)advertisingBudgetMs * 1000) return false;
+    if (readyBudgetMs && readyUs > (int64_t)readyBudgetMs * 1000) return false;
+    return true;
+}
+
+void BootProfiler::printSummary() {
+    uint8_t count = phaseCount.load();
+    if (count > MAX_PHASES) count = MAX_PHASES;
+
+    Serial.println("Boot profile (us since app start):");
+    for (uint8_t i = 0; i < count; i++) {
+        const Phase& phase = phases[i];
+        if (phase.endUs == 0) {
+            Serial.printf("  %-20s core %u  %8lu  running\n", phase.name, phase.core,
+                          (unsigned long)phase.startUs);
+            continue;
+        }
+        Serial.printf("  %-20s core %u  %8lu -> %8lu  %7lu us\n", phase.name, phase.core,
+                      (unsigned long)phase.startUs, (unsigned long)phase.endUs,
+                      (unsigned long)(phase.endUs - phase.startUs));
+    }
+
+    Serial.printf("BOOT advertising_us=%lu ready_us=%lu budget_ms=%lu/%lu %s\n",
+                  (unsigned long)advertisingUs, (unsigned long)readyUs,
+                  (unsigned long)advertisingBudgetMs, (unsigned long)readyBudgetMs,
+                  isWithinBudget() ? "PASS" : "FAIL");
+}
+
+BootPhase::BootPhase(BootProfiler& owner, const char* name) : profiler(owner) {
+    index = profiler.beginPhase(name);
+}
+
+BootPhase::~BootPhase() {
+    profiler.endPhase(index);
+}
@@ -0,0 +1,71 @@
+/*
+ * Boot Profiler Module
+ * Microsecond timeline of the startup phases
+ *
+ * Each init phase is timed by a BootPhase scope. setup() and the boot task
+ * it runs in parallel record into the same table, each with its core. Two
+ * milestones are what a player waits for and are kept apart:
+ * time-to-advertising (a host can find or reconnect the pedal) and
+ * time-to-ready (configuration loaded, footswitches live).
+ *
+ * Times come from esp_timer_get_time(), which starts with the application,
+ * so the ROM and second stage bootloader are not included. printSummary()
+ * ends with a single "BOOT ..." line for scripts comparing builds, marked
+ * PASS or FAIL against the budgets given to setBudgets().
+ */
+
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class BootProfiler {
+public:
+    static const uint8_t MAX_PHASES = 16;
+    static const uint8_t NO_PHASE = 0xFF;
+
+private:
+    struct Phase {
+        const char* name;
+        int64_t startUs;
+        int64_t endUs;  // 0 while the phase runs
+        uint8_t core;
+    };
+
+    Phase phases[MAX_PHASES];
+    std::atomic<uint8_t> phaseCount;  // Slots are claimed from any task
+
+    // setup() only
+    int64_t advertisingUs;
+    int64_t readyUs;
+    uint32_t advertisingBudgetMs;
+    uint32_t readyBudgetMs;
+
+public:
+    BootProfiler();
+    void setBudgets(uint32_t advertisingMs, uint32_t readyMs);
+
+    uint8_t beginPhase(const char* name);
+    void endPhase(uint8_t index);
+    void markAdvertising();
+    void markReady();
+
+    int64_t getTimeToAdvertisingUs();  // 0 until marked
+    int64_t getTimeToReadyUs();
+    bool isWithinBudget();
+    void printSummary();
+};
+
+// Times the enclosing scope as one boot phase
+class BootPhase {
+private:
+    BootProfiler& profiler;
+    uint8_t index;
+
+public:
+    BootPhase(BootProfiler& owner, const char* name);
+    ~BootPhase();
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Connection Manager Module Implementation
+ */
+
+#include "ConnectionManager.h"
+
+ConnectionManager::ConnectionManager() {
+    targetMinInterval = 6;   // 7.5 ms
+    targetMaxInterval = 12;  // 15 ms
+    targetLatency = 0;
+    targetTimeout = 400;     // 4 s
+    memset(peerAddress, 0, sizeof(peerAddress));
+    connected.store(false);
+    connectPending.store(false);
+    updateResult.store(RESULT_NONE);
+    grantedInterval.store(0);
+    grantedLatency.store(0);
+    grantedTimeout.store(0);
+    requestedMin = 0;
+    requestedMax = 0;
+    attempt = 0;
+    waitingForUpdate.store(false);
+    retryPending.store(false);
+    requestTime = 0;
+    requestCount = 0;
+    refusedCount = 0;
+    updateCount.store(0);
+}
+
+void ConnectionManager::begin(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+    targetMinInterval = minInterval;
+    targetMaxInterval = maxInterval;
+    targetLatency = latency;
+    targetTimeout = timeout;
+}
+
+void ConnectionManager::onConnect(const esp_ble_gatts_cb_param_t* param) {
+    memcpy(peerAddress, param->connect.remote_bda, sizeof(peerAddress));
+    grantedInterval.store(param->connect.conn_params.interval);
+    grantedLatency.store(param->connect.conn_params.latency);
+    grantedTimeout.store(param->connect.conn_params.timeout);
+    updateResult.store(RESULT_NONE);
+    connected.store(true);
+    
+    Serial.printf("Connection interval at connect: %.2f ms, latency %d, timeout %d ms\n",
+                  getIntervalMs(), param->connect.conn_params.latency,
+                  param->connect.conn_params.timeout * 10);
+    
+    // update() starts the negotiation on the loop task
+    connectPending.store(true);
+}
+
+void ConnectionManager::onDisconnect() {
+    connected.store(false);
+    connectPending.store(false);
+    waitingForUpdate.store(false);
+    retryPending.store(false);
+}
+
+void ConnectionManager::onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+    if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) return;
+    
+    bool success = (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS);
+    if (success) {
+        grantedInterval.store(param->update_conn_params.conn_int);
+        grantedLatency.store(param->update_conn_params.latency);
+        grantedTimeout.store(param->update_conn_params.timeout);
+        updateCount.fetch_add(1);
+        Serial.printf("Connection parameters granted: %.2f ms, latency %d, timeout %d ms\n",
+                      getIntervalMs(), param->update_conn_params.latency,
+                      param->update_conn_params.timeout * 10);
+    } else {
+        Serial.printf("Connection parameter update refused (status %d)\n",
+                      param->update_conn_params.status);
+    }
+    
+    // The central may also change parameters on its own
+    if (!waitingForUpdate.exchange(false)) return;
+    updateResult.store(success ? RESULT_GRANTED : RESULT_REFUSED);
+}
+
+void ConnectionManager::update() {
+    if (!connected.load()) return;
+    
+    if (connectPending.exchange(false)) {
+        attempt = 0;
+        waitingForUpdate.store(false);
+        retryPending.store(false);
+        updateResult.store(RESULT_NONE);
+        requestedMin = targetMinInterval;
+        requestedMax = targetMaxInterval;
+        if (!isTargetMet()) {
+            requestUpdate();
+        }
+        return;
+    }
+    
+    uint8_t result = updateResult.exchange(RESULT_NONE);
+    if (result != RESULT_NONE) {
+        handleResult(result == RESULT_GRANTED);
+    }
+    
+    if (waitingForUpdate.load() && millis() - requestTime > RESPONSE_TIMEOUT_MS &&
+        waitingForUpdate.exchange(false)) {
+        // No answer at all counts as a refusal
+        refusedCount++;
+        if (attempt < MAX_ATTEMPTS) {
+            requestedMin *= 2;
+            requestedMax *= 2;
+            requestTime = millis();
+            retryPending.store(true);
+        }
+    }
+    
+    if (retryPending.load() && millis() - requestTime > RETRY_DELAY_MS) {
+        retryPending.store(false);
+        requestUpdate();
+    }
+}
+
+void ConnectionManager::handleResult(bool success) {
+    if (success && isTargetMet()) return;
+    if (!success) {
+        refusedCount++;
+    }
+    
+    // Fall back to a relaxed range while it can still beat what we have
+    if (attempt >= MAX_ATTEMPTS) {
+        Serial.println("Connection parameters: keeping what the central gave us");
+        return;
+    }
+    requestedMin *= 2;
+    requestedMax *= 2;
+    if (!success || grantedInterval.load() > requestedMax) {
+        requestTime = millis();
+        retryPending.store(true);
+    }
+}
+
+void ConnectionManager::requestUpdate() {
+    esp_ble_conn_update_params_t params;
+    memcpy(params.bda, peerAddress, sizeof(params.bda));
+    params.min_int = requestedMin;
+    params.max_int = requestedMax;
+    params.latency = targetLatency;
+    params.timeout = targetTimeout;
+    
+    attempt++;
+    requestCount++;
+    requestTime = millis();
+    waitingForUpdate.store(true);
+    
+    esp_err_t err = esp_ble_gap_update_conn_params(&params);
+    Serial.printf("Requesting connection interval %.2f-%.2f ms (attempt %d)%s\n",
+                  requestedMin * 1.25f, requestedMax * 1.25f, attempt,
+                  err == ESP_OK ? "" : " failed");
+    if (err != ESP_OK) {
+        // Handled like a refusal once the response timeout expires
+        requestTime = millis() - RESPONSE_TIMEOUT_MS;
+    }
+}
+
+bool ConnectionManager::isTargetMet() {
+    uint16_t interval = grantedInterval.load();
+    return interval >= requestedMin && interval <= requestedMax;
+}
+
+bool ConnectionManager::isConnected() {
+    return connected.load();
+}
+
+ConnectionParams ConnectionManager::getParams() {
+    ConnectionParams params = {grantedInterval.load(), grantedLatency.load(), grantedTimeout.load()};
+    return params;
+}
+
+float ConnectionManager::getIntervalMs() {
+    return grantedInterval.load() * 1.25f;
+}
+
+void ConnectionManager::printStats() {
+    if (!connected.load()) {
+        Serial.println("Connection: not connected");
+    } else {
+        Serial.printf("Connection: interval %.2f ms, latency %d, timeout %d ms (target %.2f-%.2f ms)\n",
+                      getIntervalMs(), grantedLatency.load(), grantedTimeout.load() * 10,
+                      targetMinInterval * 1.25f, targetMaxInterval * 1.25f);
+    }
+    Serial.printf("Connection: %lu update requests, %lu refused, %lu updates received\n",
+                  (unsigned long)requestCount, (unsigned long)refusedCount,
+                  (unsigned long)updateCount.load());
+}
@@ -0,0 +1,98 @@
+/*
+ * Connection Manager Module
+ * Negotiates a short BLE connection interval after connecting
+ *
+ * The advertised preferred parameters are only a hint, the central picks
+ * the interval. Once connected we ask for the target interval with an
+ * L2CAP connection parameter update. If the central refuses, the request
+ * is retried with a relaxed range (both bounds doubled, e.g. 7.5-15 ms ->
+ * 15-30 ms which Apple hosts accept) up to MAX_ATTEMPTS times.
+ *
+ * The interval is the biggest part of press-to-sound latency, so the
+ * parameters actually granted are recorded for diagnostics.
+ *
+ * The BLE task only records what happened (connect, update result) in
+ * atomics. Every request and retry decision is made by update() on the
+ * loop task, which owns the attempt count and the requested range.
+ *
+ * Units are the Bluetooth ones: interval 1.25 ms, supervision timeout 10 ms.
+ */
+
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+#include <atomic>
+
+struct ConnectionParams {
+    uint16_t interval;  // 1.25 ms units
+    uint16_t latency;   // Connection events the peripheral may skip
+    uint16_t timeout;   // 10 ms units
+};
+
+class ConnectionManager {
+public:
+    static const uint8_t MAX_ATTEMPTS = 3;
+    static const unsigned long RETRY_DELAY_MS = 2000;
+    static const unsigned long RESPONSE_TIMEOUT_MS = 5000;
+
+private:
+    enum UpdateResult {
+        RESULT_NONE,
+        RESULT_GRANTED,
+        RESULT_REFUSED
+    };
+
+    // Target set by begin()
+    uint16_t targetMinInterval;
+    uint16_t targetMaxInterval;
+    uint16_t targetLatency;
+    uint16_t targetTimeout;
+
+    // Written from the BLE task
+    esp_bd_addr_t peerAddress;       // Before connectPending is set
+    std::atomic<bool> connected;
+    std::atomic<bool> connectPending;
+    std::atomic<uint8_t> updateResult;
+    std::atomic<uint16_t> grantedInterval;
+    std::atomic<uint16_t> grantedLatency;
+    std::atomic<uint16_t> grantedTimeout;
+
+    // Loop task only
+    uint16_t requestedMin;
+    uint16_t requestedMax;
+    uint8_t attempt;
+    std::atomic<bool> waitingForUpdate;  // Cleared by whoever takes the answer
+    std::atomic<bool> retryPending;
+    unsigned long requestTime;
+
+    // Statistics
+    uint32_t requestCount;
+    uint32_t refusedCount;
+    std::atomic<uint32_t> updateCount;
+
+    void requestUpdate();
+    void handleResult(bool success);
+    bool isTargetMet();
+
+public:
+    ConnectionManager();
+    void begin(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+
+    // BLE task
+    void onConnect(const esp_ble_gatts_cb_param_t* param);
+    void onDisconnect();
+    void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+    // Loop task, runs retries
+    void update();
+
+    bool isConnected();
+    ConnectionParams getParams();
+    float getIntervalMs();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Edge Capture Module Implementation
+ */
+
+#include "EdgeCapture.h"
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <soc/gpio_struct.h>
+#include <driver/gpio.h>
+
+static inline uint8_t IRAM_ATTR readPinLevel(uint8_t pin) {
+    if (pin < 32) {
+        return (REG_READ(GPIO_IN_REG) >> pin) & 0x1;
+    }
+    return (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 0x1;
+}
+
+EdgeCapture::EdgeCapture() {
+    pinCount = 0;
+    notifyTask = nullptr;
+    levelTriggered = false;
+    head.store(0);
+    tail.store(0);
+    edgeCount.store(0);
+    overflowCount.store(0);
+}
+
+void EdgeCapture::begin(const uint8_t* buttonPins, uint8_t count) {
+    if (count > MAX_PINS) count = MAX_PINS;
+    pinCount = count;
+    
+    // The loop task is woken from the ISR so it does not sleep through an edge
+    notifyTask = xTaskGetCurrentTaskHandle();
+    
+    for (uint8_t i = 0; i < pinCount; i++) {
+        pins[i].owner = this;
+        pins[i].index = i;
+        pins[i].pin = buttonPins[i];
+        attachInterruptArg(digitalPinToInterrupt(buttonPins[i]), handleInterrupt, &pins[i], CHANGE);
+    }
+    
+    Serial.printf("Edge capture initialized on %d pins\n", pinCount);
+}
+
+void EdgeCapture::enableWakeup() {
+    levelTriggered = true;
+    for (uint8_t i = 0; i < pinCount; i++) {
+        // A pin already at the other level fires at once, which is harmless
+        gpio_int_type_t wait = readPinLevel(pins[i].pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+        gpio_wakeup_enable((gpio_num_t)pins[i].pin, wait);
+    }
+}
+
+void IRAM_ATTR EdgeCapture::handleInterrupt(void* arg) {
+    PinContext* ctx = static_cast<PinContext*>(arg);
+    EdgeCapture* self = ctx->owner;
+    int64_t now = esp_timer_get_time();
+    uint8_t level = readPinLevel(ctx->pin);
+    
+    // Level mode: wait for the opposite level, or this fires again at once
+    if (self->levelTriggered) {
+        GPIO.pin[ctx->pin].int_type = level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    }
+    
+    uint32_t h = self->head.load(std::memory_order_relaxed);
+    uint32_t t = self->tail.load(std::memory_order_acquire);
+    self->edgeCount.fetch_add(1, std::memory_order_relaxed);
+    
+    if (h - t >= QUEUE_SIZE) {
+        // Consumer fell behind, the level resync in the debounce logic recovers
+        self->overflowCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        ButtonEdge& slot = self->queue[h & (QUEUE_SIZE - 1)];
+        slot.button = ctx->index;
+        slot.level = level;
+        slot.timeUs = now;
+        self->head.store(h + 1, std::memory_order_release);
+    }
+    
+    if (self->notifyTask) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->notifyTask, &woken);
+        if (woken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+bool EdgeCapture::pop(ButtonEdge& edge) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    edge = queue[t & (QUEUE_SIZE - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool EdgeCapture::hasPending() {
+    return tail.load(std::memory_order_relaxed) != head.load(std::memory_order_acquire);
+}
+
+bool EdgeCapture::waitForEdge(uint32_t timeoutMs) {
+    // Replaces a fixed delay(): returns early as soon as an edge is queued
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+}
+
+uint8_t EdgeCapture::readLevel(uint8_t index) {
+    return index < pinCount ? readPinLevel(pins[index].pin) : HIGH;
+}
+
+uint32_t EdgeCapture::getEdgeCount() {
+    return edgeCount.load(std::memory_order_relaxed);
+}
+
+uint32_t EdgeCapture::getOverflowCount() {
+    return overflowCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+/*
+ * Edge Capture Module
+ * GPIO interrupt edge capture with microsecond timestamps
+ *
+ * Each footswitch edge is stamped with esp_timer_get_time() inside the ISR
+ * and pushed into a lock-free single-producer/single-consumer ring. The
+ * producer is the GPIO ISR (all pins share one handler on the core that
+ * called begin()), the consumer is the loop task.
+ *
+ * Edge interrupts cannot wake the chip from light sleep. enableWakeup()
+ * switches the pins to level interrupts with GPIO wake-up: each pin waits
+ * for the level opposite to its current one and the ISR flips it, so every
+ * change still gives exactly one edge.
+ */
+
+#ifndef EDGE_CAPTURE_H
+#define EDGE_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+struct ButtonEdge {
+    uint8_t button;   // Index in the pin list given to begin()
+    uint8_t level;    // Pin level after the edge (LOW = pressed)
+    int64_t timeUs;   // esp_timer_get_time() at the edge
+};
+
+class EdgeCapture {
+public:
+    static const uint8_t MAX_PINS = 8;
+    static const uint32_t QUEUE_SIZE = 64;  // Power of two
+
+private:
+    struct PinContext {
+        EdgeCapture* owner;
+        uint8_t index;
+        uint8_t pin;
+    };
+    
+    PinContext pins[MAX_PINS];
+    uint8_t pinCount;
+    TaskHandle_t notifyTask;
+    bool levelTriggered;
+    
+    ButtonEdge queue[QUEUE_SIZE];
+    std::atomic<uint32_t> head;  // Written by the ISR only
+    std::atomic<uint32_t> tail;  // Written by the consumer only
+    std::atomic<uint32_t> edgeCount;
+    std::atomic<uint32_t> overflowCount;
+    
+    static void handleInterrupt(void* arg);
+    
+public:
+    EdgeCapture();
+    void begin(const uint8_t* buttonPins, uint8_t count);
+    void enableWakeup();
+    bool pop(ButtonEdge& edge);
+    bool hasPending();
+    bool waitForEdge(uint32_t timeoutMs);
+    uint8_t readLevel(uint8_t index);
+    uint32_t getEdgeCount();
+    uint32_t getOverflowCount();
+};
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * MIDI Flow Control Module Implementation
+ */
+
+#include "MidiFlowControl.h"
+
+MidiFlowControl::MidiFlowControl() {
+    pCharacteristic = nullptr;
+    congested.store(false);
+    result.store(RESULT_NONE);
+    resetRequested.store(false);
+    pendingMtu.store(0);
+    sentCount = 0;
+    retryCount = 0;
+    timeoutCount = 0;
+    rejectedCount = 0;
+    staleDropCount = 0;
+    backlogFullCount = 0;
+    invalidCount = 0;
+    maxBacklog = 0;
+    congestionCount.store(0);
+    queueLatency = {0, 0, UINT32_MAX, 0, 0};
+    sourceLatency = {0, 0, UINT32_MAX, 0, 0};
+    reset();
+}
+
+void MidiFlowControl::begin(BLECharacteristic* characteristic) {
+    pCharacteristic = characteristic;
+}
+
+uint16_t MidiFlowControl::getMaxPacketSize() {
+    return packet.getMaxPacketSize();
+}
+
+void MidiFlowControl::reset() {
+    backlogHead = 0;
+    backlogCount = 0;
+    packet.clear();
+    packetEvents = 0;
+    txData = nullptr;
+    txLength = 0;
+    txFromBacklog = false;
+    state = STATE_IDLE;
+    stateSinceUs = 0;
+}
+
+bool MidiFlowControl::sameTarget(const MidiTxEvent& a, const MidiTxEvent& b) {
+    if (a.data[0] != b.data[0]) return false;
+
+    // CC and poly pressure also carry the controller / note number
+    uint8_t type = a.data[0] & 0xF0;
+    if (type == 0xB0 || type == 0xA0) {
+        return a.data[1] == b.data[1];
+    }
+    return true;
+}
+
+bool MidiFlowControl::push(const MidiTxEvent& event) {
+    // Consumed and counted, the packet builder would refuse it forever
+    if (event.length == 0 || event.length > 3 || (event.data[0] & 0x80) == 0) {
+        invalidCount++;
+        return true;
+    }
+
+    if (event.continuous) {
+        // Supersede the newest queued value for the same controller, but
+        // never move a value across a switch event
+        for (int i = backlogCount - 1; i >= 0; i--) {
+            MidiTxEvent& queued = backlog[(backlogHead + i) % BACKLOG_SIZE];
+            if (!queued.continuous) break;
+            if (sameTarget(queued, event)) {
+                queued = event;
+                staleDropCount++;
+                return true;
+            }
+        }
+    }
+
+    if (backlogCount == BACKLOG_SIZE) {
+        if (event.continuous) {
+            // No room: the newest value wins, even across a switch event. It
+            // replaces the same controller if queued, else the newest
+            // continuous entry. Only switch events queued: it is dropped.
+            int newest = -1;
+            for (int i = backlogCount - 1; i >= 0; i--) {
+                MidiTxEvent& queued = backlog[(backlogHead + i) % BACKLOG_SIZE];
+                if (!queued.continuous) continue;
+                if (sameTarget(queued, event)) {
+                    newest = i;
+                    break;
+                }
+                if (newest < 0) newest = i;
+            }
+            if (newest >= 0) {
+                backlog[(backlogHead + newest) % BACKLOG_SIZE] = event;
+            }
+            staleDropCount++;
+            return true;
+        }
+        backlogFullCount++;
+        return false;
+    }
+
+    backlog[(backlogHead + backlogCount) % BACKLOG_SIZE] = event;
+    backlogCount++;
+    if (backlogCount > maxBacklog) {
+        maxBacklog = backlogCount;
+    }
+    return true;
+}
+
+void MidiFlowControl::update(int64_t nowUs) {
+    if (resetRequested.exchange(false)) {
+        reset();
+    }
+
+    if (state == STATE_IN_FLIGHT) {
+        uint8_t r = result.exchange(RESULT_NONE);
+        if (r == RESULT_NONE && nowUs - stateSinceUs > CONFIRM_TIMEOUT_US) {
+            timeoutCount++;
+            r = RESULT_SENT;
+        }
+
+        if (r == RESULT_SENT) {
+            complete(true, nowUs);
+        } else if (r == RESULT_REJECTED) {
+            rejectedCount++;
+            complete(false, nowUs);
+        } else if (r == RESULT_FAILED) {
+            retryCount++;
+            state = STATE_RETRY_WAIT;
+            stateSinceUs = nowUs;
+        }
+    }
+
+    if (state == STATE_RETRY_WAIT && !congested.load() &&
+        nowUs - stateSinceUs >= RETRY_DELAY_US) {
+        transmit(nowUs);
+    }
+
+    // A new MTU only applies between packets
+    if (state == STATE_IDLE) {
+        uint16_t mtu = pendingMtu.exchange(0);
+        if (mtu != 0) {
+            packet.setMtu(mtu);
+        }
+    }
+}
+
+void MidiFlowControl::sendBacklog(int64_t nowUs) {
+    if (backlogCount == 0 || !canSend()) return;
+
+    while (backlogCount > 0) {
+        const MidiTxEvent& event = backlog[backlogHead];
+        if (!packet.add(event.timestamp, event.data, event.length)) {
+            if (packetEvents > 0) break;
+            // Refused on an empty packet it would never go out, drop it
+            invalidCount++;
+            backlogHead = (backlogHead + 1) % BACKLOG_SIZE;
+            backlogCount--;
+            continue;
+        }
+
+        packetEnqueueUs[packetEvents] = event.enqueueUs;
+        packetSourceUs[packetEvents] = event.sourceUs;
+        packetEvents++;
+        backlogHead = (backlogHead + 1) % BACKLOG_SIZE;
+        backlogCount--;
+    }
+    if (packetEvents == 0) return;
+
+    txData = packet.getData();
+    txLength = packet.getLength();
+    txFromBacklog = true;
+    transmit(nowUs);
+}
+
+bool MidiFlowControl::canSend() {
+    return state == STATE_IDLE && !congested.load() && !resetRequested.load();
+}
+
+bool MidiFlowControl::send(const uint8_t* data, uint16_t length, int64_t nowUs) {
+    if (!canSend()) return false;
+
+    txData = data;
+    txLength = length;
+    txFromBacklog = false;
+    transmit(nowUs);
+    return true;
+}
+
+bool MidiFlowControl::isIdle() {
+    return state == STATE_IDLE && backlogCount == 0;
+}
+
+uint8_t MidiFlowControl::getBacklog() {
+    return backlogCount;
+}
+
+void MidiFlowControl::transmit(int64_t nowUs) {
+    state = STATE_IN_FLIGHT;
+    stateSinceUs = nowUs;
+
+    if (!pCharacteristic) {
+        result.store(RESULT_REJECTED);
+        return;
+    }
+
+    // A synchronous failure lands in onNotifyStatus() before notify() returns
+    result.store(RESULT_NONE);
+    pCharacteristic->setValue((uint8_t*)txData, txLength);
+    pCharacteristic->notify();
+}
+
+void MidiFlowControl::complete(bool delivered, int64_t nowUs) {
+    if (txFromBacklog) {
+        if (delivered) {
+            for (uint8_t i = 0; i < packetEvents; i++) {
+                recordLatency(queueLatency, (uint32_t)(nowUs - packetEnqueueUs[i]));
+                if (packetSourceUs[i] != 0) {
+                    recordLatency(sourceLatency, (uint32_t)(nowUs - packetSourceUs[i]));
+                }
+            }
+            packet.markSent();
+        } else {
+            packet.clear();
+        }
+        packetEvents = 0;
+    }
+
+    if (delivered) {
+        sentCount++;
+    }
+    txData = nullptr;
+    txLength = 0;
+    state = STATE_IDLE;
+}
+
+void MidiFlowControl::setMtu(uint16_t mtu) {
+    pendingMtu.store(mtu);
+}
+
+void MidiFlowControl::onCongestion(bool isCongested) {
+    if (isCongested) {
+        congestionCount.fetch_add(1);
+    }
+    congested.store(isCongested);
+}
+
+void MidiFlowControl::onNotifyResult(esp_gatt_status_t status) {
+    // CONGESTED still means the packet was queued in L2CAP
+    if (status == ESP_GATT_OK || status == ESP_GATT_CONGESTED) {
+        result.store(RESULT_SENT);
+    } else {
+        result.store(RESULT_FAILED);
+    }
+}
+
+void MidiFlowControl::onNotifyStatus(BLECharacteristicCallbacks::Status status) {
+    switch (status) {
+        case BLECharacteristicCallbacks::Status::ERROR_GATT:
+            result.store(RESULT_FAILED);
+            break;
+        case BLECharacteristicCallbacks::Status::ERROR_NO_CLIENT:
+        case BLECharacteristicCallbacks::Status::ERROR_NOTIFY_DISABLED:
+            result.store(RESULT_REJECTED);
+            break;
+        default:
+            break;
+    }
+}
+
+void MidiFlowControl::onDisconnect() {
+    // Queued messages are meaningless to the next central
+    congested.store(false);
+    resetRequested.store(true);
+}
+
+void MidiFlowControl::recordLatency(LatencyStats& stats, uint32_t latencyUs) {
+    stats.count++;
+    stats.lastUs = latencyUs;
+    stats.totalUs += latencyUs;
+    if (latencyUs < stats.minUs) stats.minUs = latencyUs;
+    if (latencyUs > stats.maxUs) stats.maxUs = latencyUs;
+}
+
+void MidiFlowControl::printLatency(const char* name, const LatencyStats& stats) {
+    if (stats.count == 0) {
+        Serial.printf("%s: no samples\n", name);
+        return;
+    }
+    Serial.printf("%s: last %luus, min %lu / avg %lu / max %lu, n=%lu\n", name,
+                  (unsigned long)stats.lastUs, (unsigned long)stats.minUs,
+                  (unsigned long)(stats.totalUs / stats.count),
+                  (unsigned long)stats.maxUs, (unsigned long)stats.count);
+}
+
+void MidiFlowControl::printStats() {
+    // Read while the owner task may be writing, good enough for diagnostics
+    Serial.printf("Flow control: %lu sent, %lu retries, %lu confirm timeouts, %lu rejected\n",
+                  (unsigned long)sentCount, (unsigned long)retryCount,
+                  (unsigned long)timeoutCount, (unsigned long)rejectedCount);
+    Serial.printf("Flow control: %lu congestion events%s, backlog %d (max %d/%d), "
+                  "%lu stale values dropped, %lu switch events refused, %lu invalid dropped\n",
+                  (unsigned long)congestionCount.load(), congested.load() ? " (congested)" : "",
+                  backlogCount, maxBacklog, BACKLOG_SIZE,
+                  (unsigned long)staleDropCount, (unsigned long)backlogFullCount,
+                  (unsigned long)invalidCount);
+    printLatency("Queue-to-stack", queueLatency);
+    printLatency("Press-to-stack", sourceLatency);
+    packet.printStats();
+}
@@ -0,0 +1,136 @@
+/*
+ * MIDI Flow Control Module
+ * Congestion-aware BLE-MIDI notify with retry and drop accounting
+ *
+ * notify() only queues a packet in Bluedroid. Its fate is reported later:
+ * ESP_GATTS_CONF_EVT gives the status of each notification (in order) and
+ * ESP_GATTS_CONGEST_EVT tells when the link buffers are full. A failed
+ * notification is lost unless we send it again.
+ *
+ * Messages wait in a backlog until a send credit is available. There is
+ * one credit: a packet stays in flight until its CONF_EVT arrives, so a
+ * failed packet can be resent without reordering or duplicating anything.
+ * While congested nothing is sent.
+ *
+ * Drop policy: a continuous value (pitch bend, pressure, or a CC flagged
+ * continuous by the caller) replaces an older queued value for the same
+ * controller. When the backlog is full it takes the place of the newest
+ * continuous entry, or is dropped if only switch events are queued.
+ * Switch events are never replaced or dropped; when the backlog is full
+ * push() refuses them and the caller keeps the event. Events the
+ * packet builder cannot encode (no status byte, more than 3 bytes) are
+ * dropped and counted.
+ */
+
+#ifndef MIDI_FLOW_CONTROL_H
+#define MIDI_FLOW_CONTROL_H
+
+#include <Arduino.h>
+#include <BLECharacteristic.h>
+#include <atomic>
+#include <MidiPacketBuilder.h>
+
+struct MidiTxEvent {
+    uint8_t data[3];
+    uint8_t length;
+    bool continuous;     // May be superseded by a newer value
+    uint16_t timestamp;  // 13-bit BLE-MIDI timestamp
+    int64_t sourceUs;    // Physical event time (press edge), 0 if none
+    int64_t enqueueUs;   // esp_timer_get_time() when queued
+};
+
+struct LatencyStats {
+    uint32_t count;
+    uint32_t lastUs;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+class MidiFlowControl {
+public:
+    static const uint8_t BACKLOG_SIZE = 64;
+    static const int64_t CONFIRM_TIMEOUT_US = 100000;  // No CONF_EVT: assume sent
+    static const int64_t RETRY_DELAY_US = 7500;        // About one connection interval
+
+private:
+    enum State {
+        STATE_IDLE,
+        STATE_IN_FLIGHT,
+        STATE_RETRY_WAIT
+    };
+
+    enum Result {
+        RESULT_NONE,
+        RESULT_SENT,
+        RESULT_FAILED,    // Stack refused the packet, retry
+        RESULT_REJECTED   // Nobody to send to (no client, notify disabled)
+    };
+
+    BLECharacteristic* pCharacteristic;
+
+    // Owner task only
+    MidiTxEvent backlog[BACKLOG_SIZE];
+    uint8_t backlogHead;
+    uint8_t backlogCount;
+    MidiPacketBuilder packet;
+    int64_t packetEnqueueUs[BACKLOG_SIZE];
+    int64_t packetSourceUs[BACKLOG_SIZE];
+    uint8_t packetEvents;
+    const uint8_t* txData;  // Packet in flight, kept for a retry
+    uint16_t txLength;
+    bool txFromBacklog;
+    State state;
+    int64_t stateSinceUs;
+
+    // Written from the BLE task
+    std::atomic<bool> congested;
+    std::atomic<uint8_t> result;
+    std::atomic<bool> resetRequested;
+    std::atomic<uint16_t> pendingMtu;
+
+    // Statistics
+    uint32_t sentCount;
+    uint32_t retryCount;
+    uint32_t timeoutCount;
+    uint32_t rejectedCount;
+    uint32_t staleDropCount;
+    uint32_t backlogFullCount;
+    uint32_t invalidCount;
+    uint8_t maxBacklog;
+    std::atomic<uint32_t> congestionCount;
+    LatencyStats queueLatency;   // Queued -> accepted by the stack
+    LatencyStats sourceLatency;  // Press edge -> accepted by the stack
+
+    void transmit(int64_t nowUs);
+    void complete(bool delivered, int64_t nowUs);
+    void reset();
+    static bool sameTarget(const MidiTxEvent& a, const MidiTxEvent& b);
+    static void recordLatency(LatencyStats& stats, uint32_t latencyUs);
+    static void printLatency(const char* name, const LatencyStats& stats);
+
+public:
+    MidiFlowControl();
+    void begin(BLECharacteristic* characteristic);
+    uint16_t getMaxPacketSize();
+
+    // Owner task (the one calling update())
+    bool push(const MidiTxEvent& event);
+    void update(int64_t nowUs);
+    void sendBacklog(int64_t nowUs);
+    bool canSend();
+    bool send(const uint8_t* data, uint16_t length, int64_t nowUs);  // data kept until canSend()
+    bool isIdle();
+    uint8_t getBacklog();
+
+    // BLE task
+    void setMtu(uint16_t mtu);
+    void onCongestion(bool isCongested);
+    void onNotifyResult(esp_gatt_status_t status);
+    void onNotifyStatus(BLECharacteristicCallbacks::Status status);
+    void onDisconnect();
+
+    void printStats();
+};
+
+#endif
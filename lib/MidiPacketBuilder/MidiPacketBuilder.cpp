@@ -0,0 +1,150 @@
+/*
+ * MIDI Packet Builder Module Implementation
+ */
+
+#include "MidiPacketBuilder.h"
+
+MidiPacketBuilder::MidiPacketBuilder() {
+    packetLength = 0;
+    maxPacketSize = MIN_PACKET_SIZE;
+    currentHigh = 0;
+    lastTimestamp = 0;
+    runningStatus = 0;
+    runningStatusEnabled = true;
+    pendingMessages = 0;
+    packetCount = 0;
+    messageCount = 0;
+    byteCount = 0;
+    runningStatusHits = 0;
+    maxMessagesPerPacket = 0;
+}
+
+uint16_t MidiPacketBuilder::timestampFromMillis(unsigned long ms) {
+    return ms & 0x1FFF;
+}
+
+uint16_t MidiPacketBuilder::timestampFromMicros(int64_t us) {
+    return (uint16_t)((us / 1000) & 0x1FFF);
+}
+
+void MidiPacketBuilder::setMtu(uint16_t mtu) {
+    // The notification payload is the ATT MTU minus the 3-byte ATT header
+    uint16_t size = mtu > 3 ? mtu - 3 : MIN_PACKET_SIZE;
+    maxPacketSize = constrain(size, MIN_PACKET_SIZE, MAX_PACKET_SIZE);
+}
+
+uint16_t MidiPacketBuilder::getMaxPacketSize() {
+    return maxPacketSize;
+}
+
+void MidiPacketBuilder::setRunningStatus(bool enabled) {
+    runningStatusEnabled = enabled;
+}
+
+bool MidiPacketBuilder::add(uint16_t timestampMs, const uint8_t* message, uint8_t length) {
+    if (length == 0 || length > 3 || (message[0] & 0x80) == 0) return false;
+    
+    uint8_t status = message[0];
+    uint16_t timestamp = timestampMs & 0x1FFF;
+    
+    if (packetLength > 0) {
+        // Events stamped earlier than the previous message (another button
+        // scanned later in the same pass) are clamped to keep time monotonic
+        uint16_t delta = (timestamp - lastTimestamp) & 0x1FFF;
+        if (delta >= 0x1000) {
+            timestamp = lastTimestamp;
+        }
+    }
+    
+    uint8_t high = (timestamp >> 7) & 0x3F;
+    uint8_t low = timestamp & 0x7F;
+    uint8_t lastLow = lastTimestamp & 0x7F;
+    
+    // The high bits can only advance through a single wrap of the low byte,
+    // anything else needs a new header
+    if (packetLength > 0 && high != currentHigh) {
+        if (high != ((currentHigh + 1) & 0x3F) || low >= lastLow) return false;
+    }
+    
+    // Running status: the status byte is dropped for a repeated channel
+    // status, and the timestamp byte too when it has not changed
+    bool sameStatus = runningStatusEnabled && packetLength > 0 && status == runningStatus;
+    bool needTimestamp = !sameStatus || timestamp != lastTimestamp;
+    uint16_t needed = (packetLength == 0 ? 1 : 0) + (needTimestamp ? 1 : 0) + (sameStatus ? length - 1 : length);
+    if (packetLength + needed > maxPacketSize) return false;
+    
+    if (packetLength == 0) {
+        buffer[packetLength++] = 0x80 | high;
+    }
+    if (needTimestamp) {
+        buffer[packetLength++] = 0x80 | low;
+    }
+    if (sameStatus) {
+        runningStatusHits++;
+    } else {
+        buffer[packetLength++] = status;
+    }
+    for (uint8_t i = 1; i < length; i++) {
+        buffer[packetLength++] = message[i] & 0x7F;
+    }
+    
+    // Only channel messages (0x80-0xEF) establish running status
+    runningStatus = status < 0xF0 ? status : 0;
+    currentHigh = high;
+    lastTimestamp = timestamp;
+    pendingMessages++;
+    return true;
+}
+
+bool MidiPacketBuilder::isEmpty() {
+    return packetLength == 0;
+}
+
+const uint8_t* MidiPacketBuilder::getData() {
+    return buffer;
+}
+
+uint16_t MidiPacketBuilder::getLength() {
+    return packetLength;
+}
+
+uint8_t MidiPacketBuilder::getPendingMessages() {
+    return pendingMessages;
+}
+
+void MidiPacketBuilder::markSent() {
+    if (packetLength == 0) return;
+    
+    packetCount++;
+    messageCount += pendingMessages;
+    byteCount += packetLength;
+    if (pendingMessages > maxMessagesPerPacket) {
+        maxMessagesPerPacket = pendingMessages;
+    }
+    clear();
+}
+
+void MidiPacketBuilder::clear() {
+    packetLength = 0;
+    pendingMessages = 0;
+    runningStatus = 0;
+}
+
+uint32_t MidiPacketBuilder::getPacketCount() {
+    return packetCount;
+}
+
+uint32_t MidiPacketBuilder::getMessageCount() {
+    return messageCount;
+}
+
+void MidiPacketBuilder::printStats() {
+    Serial.printf("MIDI packets: %lu, messages: %lu (%.2f/packet, max %d), bytes: %lu, running status: %lu, max payload: %d\n",
+                  (unsigned long)packetCount,
+                  (unsigned long)messageCount,
+                  packetCount ? (float)messageCount / packetCount : 0.0f,
+                  maxMessagesPerPacket,
+                  (unsigned long)byteCount,
+                  (unsigned long)runningStatusHits,
+                  maxPacketSize);
+}
@@ -0,0 +1,65 @@
+/*
+ * MIDI Packet Builder Module
+ * Coalesces several MIDI messages into one BLE-MIDI notification
+ *
+ * Packet layout (BLE-MIDI spec): one header byte carrying timestamp bits
+ * 12-7, then for each message a timestamp byte (bits 6-0) and the message.
+ * Consecutive channel messages with the same status use running status.
+ *
+ * Timestamps are the 13-bit value of a millisecond clock. When the low byte
+ * goes backwards inside a packet the receiver increments the high bits, so
+ * timestamps within a packet must never decrease.
+ */
+
+#ifndef MIDI_PACKET_BUILDER_H
+#define MIDI_PACKET_BUILDER_H
+
+#include <Arduino.h>
+
+class MidiPacketBuilder {
+public:
+    static const uint16_t MAX_PACKET_SIZE = 244;  // ATT MTU 247 - 3
+    static const uint16_t MIN_PACKET_SIZE = 20;   // Default ATT MTU 23 - 3
+
+private:
+    uint8_t buffer[MAX_PACKET_SIZE];
+    uint16_t packetLength;
+    uint16_t maxPacketSize;
+    uint8_t currentHigh;     // High bits as the receiver tracks them
+    uint16_t lastTimestamp;  // 13-bit timestamp of the last message
+    uint8_t runningStatus;
+    bool runningStatusEnabled;
+    uint8_t pendingMessages;
+    
+    // Statistics
+    uint32_t packetCount;
+    uint32_t messageCount;
+    uint32_t byteCount;
+    uint32_t runningStatusHits;
+    uint8_t maxMessagesPerPacket;
+    
+public:
+    MidiPacketBuilder();
+    static uint16_t timestampFromMillis(unsigned long ms);
+    static uint16_t timestampFromMicros(int64_t us);
+    void setMtu(uint16_t mtu);
+    uint16_t getMaxPacketSize();
+    void setRunningStatus(bool enabled);
+    
+    // Returns false when the message does not fit, the caller sends the
+    // pending packet and adds it again
+    bool add(uint16_t timestampMs, const uint8_t* message, uint8_t length);
+    
+    bool isEmpty();
+    const uint8_t* getData();
+    uint16_t getLength();
+    uint8_t getPendingMessages();
+    void markSent();
+    void clear();
+    
+    uint32_t getPacketCount();
+    uint32_t getMessageCount();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * MIDI Parser Module Implementation
+ */
+
+#include "MidiParser.h"
+
+MidiParser::MidiParser() {
+    head.store(0);
+    tail.store(0);
+    sysexReady.store(0);
+    packetCount.store(0);
+    messageCount.store(0);
+    invalidCount.store(0);
+    overflowCount.store(0);
+    reset();
+}
+
+void MidiParser::reset() {
+    // Decoder state only, queued messages stay for the consumer
+    runningStatus = 0;
+    dataIndex = 0;
+    dataNeeded = 0;
+    lastLow = 0;
+    inSysEx = false;
+    sysexLength = 0;
+    sysexTruncated = false;
+}
+
+uint8_t MidiParser::dataLength(uint8_t status) {
+    switch (status & 0xF0) {
+        case 0xC0:  // Program Change
+        case 0xD0:  // Channel Pressure
+            return 1;
+        case 0xF0:
+            break;
+        default:
+            return 2;
+    }
+
+    switch (status) {
+        case 0xF1:  // MTC quarter frame
+        case 0xF3:  // Song select
+            return 1;
+        case 0xF2:  // Song position
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+void MidiParser::parse(const uint8_t* data, size_t length) {
+    packetCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Header byte: bit 7 set, bit 6 clear, timestamp bits 12-7
+    if (length < 2 || (data[0] & 0xC0) != 0x80) {
+        invalidCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint8_t high = data[0] & 0x3F;
+    uint16_t timestamp = (uint16_t)high << 7;
+    bool haveTimestamp = false;
+    size_t i = 1;
+
+    // Only a SysEx continuation may start with data bytes
+    if (!inSysEx && !(data[1] & 0x80)) {
+        invalidCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    while (i < length) {
+        uint8_t b = data[i++];
+
+        if (b & 0x80) {
+            // Timestamp byte, the low 7 bits going backwards means a wrap
+            uint8_t low = b & 0x7F;
+            if (haveTimestamp && low < lastLow) {
+                high = (high + 1) & 0x3F;
+            }
+            lastLow = low;
+            haveTimestamp = true;
+            timestamp = ((uint16_t)high << 7) | low;
+
+            if (i >= length) {
+                invalidCount.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            // A status byte follows, or a data byte continuing running status
+            b = data[i++];
+            if (b & 0x80) {
+                handleStatus(b, timestamp);
+                continue;
+            }
+        }
+
+        handleData(b, timestamp);
+    }
+}
+
+void MidiParser::handleStatus(uint8_t status, uint16_t timestamp) {
+    // Real-time messages may appear anywhere, even inside SysEx
+    if (status >= 0xF8) {
+        push(timestamp, status, 1);
+        return;
+    }
+
+    if (status == 0xF7) {
+        if (inSysEx) {
+            finishSysEx(timestamp);
+        }
+        return;
+    }
+
+    if (inSysEx) {
+        // Any other status aborts an unterminated SysEx
+        inSysEx = false;
+        invalidCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (status == 0xF0) {
+        inSysEx = true;
+        sysexLength = 0;
+        sysexTruncated = false;
+        runningStatus = 0;
+        return;
+    }
+
+    dataIndex = 0;
+    dataNeeded = dataLength(status);
+
+    if (status >= 0xF0 && dataNeeded == 0) {
+        runningStatus = 0;
+        push(timestamp, status, 1);
+        return;
+    }
+
+    // System common messages only keep their status until complete
+    runningStatus = status;
+}
+
+void MidiParser::handleData(uint8_t data, uint16_t timestamp) {
+    if (inSysEx) {
+        if (sysexLength < SYSEX_BUFFER_SIZE) {
+            sysexAssembly[sysexLength++] = data;
+        } else {
+            sysexTruncated = true;
+        }
+        return;
+    }
+
+    if (runningStatus == 0) {
+        // Data byte without a status to belong to
+        invalidCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    dataBytes[dataIndex++] = data;
+    if (dataIndex < dataNeeded) return;
+
+    push(timestamp, runningStatus, dataNeeded + 1);
+    dataIndex = 0;
+
+    if (runningStatus >= 0xF0) {
+        runningStatus = 0;
+    }
+}
+
+void MidiParser::finishSysEx(uint16_t timestamp) {
+    inSysEx = false;
+
+    // One completed SysEx waits for the consumer, newer ones are dropped
+    if (sysexTruncated || sysexReady.load(std::memory_order_acquire) != 0) {
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    memcpy(sysexBuffer, sysexAssembly, sysexLength);
+    sysexReady.store(sysexLength + 1, std::memory_order_release);
+    push(timestamp, 0xF0, 0);
+}
+
+void MidiParser::push(uint16_t timestamp, uint8_t status, uint8_t length) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+
+    if (h - t >= QUEUE_SIZE) {
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    MidiMessage& slot = queue[h & (QUEUE_SIZE - 1)];
+    slot.timestamp = timestamp;
+    slot.status = status;
+    slot.data1 = (length > 1) ? dataBytes[0] : 0;
+    slot.data2 = (length > 2) ? dataBytes[1] : 0;
+    slot.length = length;
+    head.store(h + 1, std::memory_order_release);
+    messageCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool MidiParser::pop(MidiMessage& message) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    message = queue[t & (QUEUE_SIZE - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+size_t MidiParser::readSysEx(uint8_t* dest, size_t maxLength) {
+    uint16_t ready = sysexReady.load(std::memory_order_acquire);
+    if (ready == 0) return 0;
+
+    size_t count = ready - 1;
+    if (count > maxLength) count = maxLength;
+    memcpy(dest, sysexBuffer, count);
+
+    // Frees the buffer for the next SysEx
+    sysexReady.store(0, std::memory_order_release);
+    return count;
+}
+
+uint32_t MidiParser::getPacketCount() {
+    return packetCount.load();
+}
+
+uint32_t MidiParser::getMessageCount() {
+    return messageCount.load();
+}
+
+uint32_t MidiParser::getInvalidCount() {
+    return invalidCount.load();
+}
+
+uint32_t MidiParser::getOverflowCount() {
+    return overflowCount.load();
+}
+
+void MidiParser::printStats() {
+    Serial.printf("MIDI in: %lu packets, %lu messages, %lu invalid, %lu dropped\n",
+                  (unsigned long)packetCount.load(), (unsigned long)messageCount.load(),
+                  (unsigned long)invalidCount.load(), (unsigned long)overflowCount.load());
+}
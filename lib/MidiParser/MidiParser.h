@@ -0,0 +1,83 @@
+/*
+ * MIDI Parser Module
+ * Streaming decoder for BLE-MIDI packets written by the host
+ *
+ * Runs in the BLE write callback without touching the heap: decoded
+ * messages go into a fixed lock-free single-producer/single-consumer ring.
+ * The producer is the Bluedroid task, the consumer is the loop task.
+ *
+ * Handles the packet header, per-message timestamps (with low-byte wrap),
+ * running status with or without a timestamp in front, interleaved
+ * real-time messages and SysEx that spans several packets. A completed
+ * SysEx is kept in one static buffer until the consumer reads it.
+ */
+
+#ifndef MIDI_PARSER_H
+#define MIDI_PARSER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+struct MidiMessage {
+    uint16_t timestamp;  // 13-bit BLE-MIDI timestamp
+    uint8_t status;      // 0xF0 for a completed SysEx, see readSysEx()
+    uint8_t data1;
+    uint8_t data2;
+    uint8_t length;      // Bytes including status, 0 for SysEx
+};
+
+class MidiParser {
+public:
+    static const uint32_t QUEUE_SIZE = 32;        // Power of two
+    static const uint16_t SYSEX_BUFFER_SIZE = 128;
+
+private:
+    MidiMessage queue[QUEUE_SIZE];
+    std::atomic<uint32_t> head;  // Written by the BLE task only
+    std::atomic<uint32_t> tail;  // Written by the consumer only
+
+    // Decoder state, BLE task only
+    uint8_t runningStatus;
+    uint8_t dataBytes[2];
+    uint8_t dataIndex;
+    uint8_t dataNeeded;
+    uint8_t lastLow;
+    bool inSysEx;
+    uint16_t sysexLength;
+    bool sysexTruncated;
+    uint8_t sysexAssembly[SYSEX_BUFFER_SIZE];
+
+    // Completed SysEx handed to the consumer
+    uint8_t sysexBuffer[SYSEX_BUFFER_SIZE];
+    std::atomic<uint16_t> sysexReady;  // Length + 1, 0 when free
+
+    // Statistics
+    std::atomic<uint32_t> packetCount;
+    std::atomic<uint32_t> messageCount;
+    std::atomic<uint32_t> invalidCount;
+    std::atomic<uint32_t> overflowCount;
+
+    void handleStatus(uint8_t status, uint16_t timestamp);
+    void handleData(uint8_t data, uint16_t timestamp);
+    void finishSysEx(uint16_t timestamp);
+    void push(uint16_t timestamp, uint8_t status, uint8_t length);
+    static uint8_t dataLength(uint8_t status);
+
+public:
+    MidiParser();
+    void reset();
+
+    // Decodes one BLE-MIDI packet, called from the characteristic write
+    void parse(const uint8_t* data, size_t length);
+
+    bool pop(MidiMessage& message);
+    size_t readSysEx(uint8_t* dest, size_t maxLength);
+
+    uint32_t getPacketCount();
+    uint32_t getMessageCount();
+    uint32_t getInvalidCount();
+    uint32_t getOverflowCount();
+    void printStats();
+};
+
+#endif
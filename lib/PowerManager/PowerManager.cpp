@@ -0,0 +1,222 @@
+/*
+ * Power Manager Module Implementation
+ */
+
+#include "PowerManager.h"
+#include <esp_bt.h>
+#include <esp_timer.h>
+#include <esp_freertos_hooks.h>
+#include <hal/cpu_hal.h>
+
+PowerManager* PowerManager::instance = nullptr;
+
+PowerManager::PowerManager() {
+    activeLock = nullptr;
+    awakeLock = nullptr;
+    enabled = false;
+    lightSleep = false;
+    awakeHeld = false;
+    maxFreqMhz = 0;
+    minFreqMhz = 0;
+    lastHookUs = 0;
+    lastHookCycles = 0;
+    asleepUs = 0;
+    awakeUs = 0;
+    sleepCount = 0;
+}
+
+bool PowerManager::begin(int maxMhz, int minMhz, bool enableLightSleep) {
+    esp_err_t err = configure(maxMhz, minMhz, enableLightSleep);
+    if (err != ESP_OK && enableLightSleep) {
+        // Tickless idle is off in this SDK build, keep frequency scaling
+        Serial.printf("Power: light sleep unavailable (%s)\n", esp_err_to_name(err));
+        enableLightSleep = false;
+        err = configure(maxMhz, minMhz, false);
+    }
+    if (err != ESP_OK) {
+        Serial.printf("Power: power management unavailable (%s)\n", esp_err_to_name(err));
+        return false;
+    }
+    enabled = true;
+    lightSleep = enableLightSleep;
+    maxFreqMhz = maxMhz;
+    minFreqMhz = minMhz;
+    
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "midi_active", &activeLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "disconnected", &awakeLock);
+    setConnected(false);
+    
+    if (lightSleep) {
+        // Controller sleeps between connection events, needs modem sleep in sdkconfig
+        err = esp_bt_sleep_enable();
+        if (err != ESP_OK) {
+            Serial.printf("Power: BLE modem sleep unavailable (%s)\n", esp_err_to_name(err));
+        }
+        esp_sleep_enable_gpio_wakeup();
+        
+        instance = this;
+        esp_register_freertos_idle_hook_for_cpu(idleHook, 0);
+    }
+    
+    Serial.printf("Power: %d-%d MHz, light sleep %s\n", minMhz, maxMhz, lightSleep ? "on" : "off");
+    return true;
+}
+
+esp_err_t PowerManager::configure(int maxMhz, int minMhz, bool enableLightSleep) {
+    esp_pm_config_esp32_t config = {};
+    config.max_freq_mhz = maxMhz;
+    config.min_freq_mhz = minMhz;
+    config.light_sleep_enable = enableLightSleep;
+    return esp_pm_configure(&config);
+}
+
+esp_pm_lock_handle_t PowerManager::getActiveLock() {
+    return activeLock;
+}
+
+void PowerManager::setConnected(bool connected) {
+    if (!awakeLock || connected != awakeHeld) return;
+    awakeHeld = !connected;
+    if (awakeHeld) {
+        esp_pm_lock_acquire(awakeLock);
+    } else {
+        esp_pm_lock_release(awakeLock);
+    }
+}
+
+bool PowerManager::isLightSleepEnabled() {
+    return lightSleep;
+}
+
+bool IRAM_ATTR PowerManager::idleHook() {
+    instance->account();
+    return true;
+}
+
+void IRAM_ATTR PowerManager::account() {
+    int64_t now = esp_timer_get_time();
+    uint32_t cycles = cpu_hal_get_cycle_count();
+    
+    if (lastHookUs != 0) {
+        uint32_t elapsedUs = (uint32_t)(now - lastHookUs);
+        // DFS may have switched frequency any number of times since the last
+        // call. The CPU never runs below minFreqMhz while awake, so this is
+        // the longest the counted cycles can have taken.
+        uint32_t runUs = (cycles - lastHookCycles) / minFreqMhz;
+        if (runUs > elapsedUs) runUs = elapsedUs;
+        
+        // Our NO_LIGHT_SLEEP lock rules sleep out, light sleep lasts at
+        // least a few ticks
+        if (!awakeHeld && elapsedUs - runUs >= MIN_SLEEP_US) {
+            asleepUs += elapsedUs - runUs;
+            awakeUs += runUs;
+            sleepCount++;
+        } else {
+            awakeUs += elapsedUs;
+        }
+    }
+    lastHookUs = now;
+    lastHookCycles = cycles;
+}
+
+uint32_t PowerManager::typicalCurrentMa(int mhz) {
+    // ESP32 datasheet, modem sleep, both cores running, middle of the range
+    if (mhz >= 240) return 49;
+    if (mhz >= 160) return 36;
+    return 26;
+}
+
+void PowerManager::runBenchmark(void (*workload)(void*), void* context) {
+    static const FrequencyPolicy policies[] = {
+        {"fixed 240", 240, 240},
+        {"fixed 160", 160, 160},
+        {"fixed 80",  80,  80},
+        {"DFS 80-240", 240, 80}
+    };
+    
+    if (!enabled) {
+        Serial.println("Benchmark: needs power management");
+        return;
+    }
+    
+    // Light sleep off, it would hide the frequency effect
+    for (uint8_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        const FrequencyPolicy& policy = policies[p];
+        if (configure(policy.maxMhz, policy.minMhz, false) != ESP_OK) {
+            Serial.printf("Benchmark: %s not supported\n", policy.name);
+            continue;
+        }
+        delay(BENCHMARK_SETTLE_MS);
+        Serial.printf("Benchmark: %s window start\n", policy.name);
+        
+        uint32_t count = 0;
+        uint32_t minUs = UINT32_MAX;
+        uint32_t maxUs = 0;
+        uint64_t totalUs = 0;
+        unsigned long start = millis();
+        while (millis() - start < BENCHMARK_WINDOW_MS) {
+            // Includes the switch to the maximum frequency, as a real event would
+            int64_t t0 = esp_timer_get_time();
+            {
+                PowerLock boost(*this);
+                workload(context);
+            }
+            uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+            
+            count++;
+            totalUs += us;
+            if (us < minUs) minUs = us;
+            if (us > maxUs) maxUs = us;
+            delay(BENCHMARK_EVENT_MS);
+        }
+        
+        // Busy time at the maximum, the rest idle at the minimum
+        uint32_t busyPermille = (uint32_t)(totalUs / BENCHMARK_WINDOW_MS);
+        uint32_t currentMa = (typicalCurrentMa(policy.maxMhz) * busyPermille +
+                              typicalCurrentMa(policy.minMhz) * (1000 - busyPermille)) / 1000;
+        Serial.printf("Benchmark: %-10s latency min %lu / avg %lu / max %lu us, busy %lu.%lu%%, ~%lu mA est.\n",
+                      policy.name, (unsigned long)minUs, (unsigned long)(totalUs / count),
+                      (unsigned long)maxUs, (unsigned long)(busyPermille / 10),
+                      (unsigned long)(busyPermille % 10), (unsigned long)currentMa);
+    }
+    
+    configure(maxFreqMhz, minFreqMhz, lightSleep);
+    Serial.println("Benchmark: done, power policy restored");
+}
+
+void PowerManager::printStats() {
+    if (!enabled) {
+        Serial.println("Power: power management off");
+        return;
+    }
+    if (!lightSleep) {
+        Serial.printf("Power: %d-%d MHz, no light sleep\n", minFreqMhz, maxFreqMhz);
+        return;
+    }
+    
+    // Written by the idle hook, good enough for diagnostics
+    uint64_t asleep = asleepUs;
+    uint64_t awake = awakeUs;
+    uint64_t total = asleep + awake;
+    Serial.printf("Power: asleep >= %lu s / awake %lu s (>= %lu%% asleep), %lu sleeps%s\n",
+                  (unsigned long)(asleep / 1000000), (unsigned long)(awake / 1000000),
+                  total ? (unsigned long)(asleep * 100 / total) : 0UL,
+                  (unsigned long)sleepCount, awakeHeld ? ", held awake while disconnected" : "");
+#ifdef CONFIG_PM_PROFILING
+    // Time per power mode, timed by esp_pm at each light sleep entry and exit
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+PowerLock::PowerLock(PowerManager& manager, bool active) {
+    lock = active ? manager.getActiveLock() : nullptr;
+    if (lock) {
+        esp_pm_lock_acquire(lock);
+    }
+}
+
+PowerLock::~PowerLock() {
+    if (lock) {
+        esp_pm_lock_release(lock);
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Power Manager Module
+ * Dynamic frequency scaling and automatic light sleep
+ *
+ * esp_pm runs the CPU at the minimum frequency (80 MHz) and lets the idle
+ * task enter light sleep whenever every task is blocked. The BLE
+ * controller uses modem sleep and wakes the chip for each connection
+ * event. Footswitches wake it through GPIO (EdgeCapture::enableWakeup()).
+ *
+ * Hot paths (button events, building and notifying MIDI, display redraws)
+ * run at the maximum frequency inside a scoped PowerLock, so none of them
+ * waits for a frequency switch or a wake-up halfway through.
+ * While disconnected a NO_LIGHT_SLEEP lock keeps things as they were;
+ * deep sleep after SLEEP_TIMEOUT_MS covers that case. The serial console
+ * only reads between wake-ups while connected.
+ *
+ * Light sleep needs CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE
+ * in the SDK configuration. Without them begin() falls back to frequency
+ * scaling only, or to nothing, and says so.
+ *
+ * Time asleep is estimated on core 0: the cycle counter stops in light
+ * sleep while esp_timer keeps counting, so the gap between two idle hook
+ * calls that the cycle counter does not account for was spent asleep.
+ * Cycles are converted at the minimum frequency, as DFS may have changed
+ * it in between, which makes the figure a lower bound. Built with
+ * CONFIG_PM_PROFILING, printStats() adds esp_pm's own time per mode,
+ * measured at light sleep entry and exit.
+ *
+ * runBenchmark() runs a workload under each frequency policy in turn and
+ * prints its latency with an average current estimated from datasheet
+ * figures. Each policy holds for BENCHMARK_WINDOW_MS, long enough to read
+ * a meter on the supply for the real number.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <atomic>
+
+struct FrequencyPolicy {
+    const char* name;
+    int maxMhz;
+    int minMhz;
+};
+
+class PowerManager {
+public:
+    static const uint32_t MIN_SLEEP_US = 1000;  // Shorter gaps are measurement noise
+    static const unsigned long BENCHMARK_WINDOW_MS = 5000;
+    static const unsigned long BENCHMARK_EVENT_MS = 50;
+    static const unsigned long BENCHMARK_SETTLE_MS = 500;
+
+private:
+    esp_pm_lock_handle_t activeLock;
+    esp_pm_lock_handle_t awakeLock;
+    bool enabled;
+    bool lightSleep;
+    bool awakeHeld;
+    int maxFreqMhz;
+    int minFreqMhz;
+
+    // Idle hook on core 0
+    static PowerManager* instance;
+    int64_t lastHookUs;
+    uint32_t lastHookCycles;
+    uint64_t asleepUs;
+    uint64_t awakeUs;
+    uint32_t sleepCount;
+
+    static bool idleHook();
+    void account();
+    esp_err_t configure(int maxMhz, int minMhz, bool enableLightSleep);
+    static uint32_t typicalCurrentMa(int mhz);
+
+public:
+    PowerManager();
+    bool begin(int maxMhz, int minMhz, bool enableLightSleep);
+
+    // Counted by esp_pm, any task may hold it
+    esp_pm_lock_handle_t getActiveLock();
+
+    // Loop task
+    void setConnected(bool connected);
+    bool isLightSleepEnabled();
+    void runBenchmark(void (*workload)(void*), void* context);
+    void printStats();
+};
+
+// Maximum frequency for the enclosing scope
+class PowerLock {
+private:
+    esp_pm_lock_handle_t lock;
+
+public:
+    explicit PowerLock(PowerManager& manager, bool active = true);
+    ~PowerLock();
+};
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Reconnect Manager Module Implementation
+ */
+
+#include "ReconnectManager.h"
+
+ReconnectManager::ReconnectManager() {
+    pAdvertising = nullptr;
+    schedule = nullptr;
+    stepCount = 0;
+    firstOpenStep = 0;
+    hasHost = false;
+    memset(hostAddress, 0, sizeof(hostAddress));
+    hostAddressType = BLE_ADDR_TYPE_PUBLIC;
+    step.store(STEP_CONNECTED);
+    disconnectTime.store(0);
+    stepStart = 0;
+    runningStep = STEP_CONNECTED;
+    runningSince = 0;
+    advertisingMs = 0;
+    radioOnUs = 0;
+    historyCount = 0;
+    historyNext = 0;
+}
+
+void ReconnectManager::begin(BLEAdvertising* advertising, const AdvertisingStep* steps, uint8_t count) {
+    pAdvertising = advertising;
+    schedule = steps;
+    stepCount = count;
+    
+    // Pairing mode and the press restart start from the first open step
+    firstOpenStep = count - 1;
+    for (uint8_t i = 0; i < count; i++) {
+        if (steps[i].type == ADV_OPEN) {
+            firstOpenStep = i;
+            break;
+        }
+    }
+    
+    // Bond on first connection, keep encryption and identity keys (IRK)
+    BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
+    BLESecurity* security = new BLESecurity();
+    security->setAuthenticationMode(ESP_LE_AUTH_REQ_SC_BOND);
+    security->setCapability(ESP_IO_CAP_NONE);
+    security->setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+    security->setRespEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+    
+    prefs.begin("reconnect", false);
+    if (prefs.getBytes("host", hostAddress, sizeof(hostAddress)) == sizeof(hostAddress)) {
+        hostAddressType = (esp_ble_addr_type_t)prefs.getUChar("hostType", BLE_ADDR_TYPE_PUBLIC);
+        hasHost = true;
+    }
+    
+    // The host may have been unpaired by a factory reset of the bond store
+    if (hasHost) {
+        int bondCount = esp_ble_get_bond_device_num();
+        bool bonded = false;
+        if (bondCount > 0) {
+            esp_ble_bond_dev_t* devices = (esp_ble_bond_dev_t*)malloc(sizeof(esp_ble_bond_dev_t) * bondCount);
+            if (devices && esp_ble_get_bond_device_list(&bondCount, devices) == ESP_OK) {
+                for (int i = 0; i < bondCount; i++) {
+                    if (memcmp(devices[i].bd_addr, hostAddress, sizeof(hostAddress)) == 0) {
+                        bonded = true;
+                    }
+                }
+            }
+            free(devices);
+        }
+        hasHost = bonded;
+    }
+    
+    if (hasHost) {
+        esp_ble_gap_update_whitelist(true, hostAddress,
+                                     hostAddressType == BLE_ADDR_TYPE_PUBLIC ? BLE_WL_ADDR_TYPE_PUBLIC
+                                                                             : BLE_WL_ADDR_TYPE_RANDOM);
+        Serial.printf("Reconnect: bonded host %02X:%02X:%02X:%02X:%02X:%02X\n",
+                      hostAddress[0], hostAddress[1], hostAddress[2],
+                      hostAddress[3], hostAddress[4], hostAddress[5]);
+    } else {
+        Serial.println("Reconnect: no bonded host");
+    }
+    
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t permille = estimateDutyPermille(steps[i]);
+        Serial.printf("  step %d %-9s %4lu-%4lu ms, %+d dBm, %lu ms, radio ~%lu.%lu%%\n", i, steps[i].name,
+                      (unsigned long)(steps[i].minInterval * 5 / 8),
+                      (unsigned long)(steps[i].maxInterval * 5 / 8),
+                      -12 + 3 * (int)steps[i].txPower, (unsigned long)steps[i].durationMs,
+                      (unsigned long)(permille / 10), (unsigned long)(permille % 10));
+    }
+}
+
+void ReconnectManager::start() {
+    // Boot counts like a disconnect, a power blip mid-show is the case to win
+    disconnectTime.store(millis());
+    startStep(nextUsableStep(0));
+}
+
+void ReconnectManager::startPairing() {
+    // Any host may connect, the schedule slows down from there as usual
+    uint8_t current = step.load();
+    if (current == STEP_CONNECTED) {
+        const AdvertisingStep& entry = schedule[firstOpenStep];
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, entry.txPower);
+        startUndirected(entry);
+        return;
+    }
+    advance(current, firstOpenStep);
+}
+
+void ReconnectManager::onActivity() {
+    // Someone is at the pedal, the host is probably looking for it too
+    uint8_t current = step.load();
+    if (current == STEP_CONNECTED || current <= firstOpenStep) return;
+    
+    Serial.println("Reconnect: activity, back to fast advertising");
+    advance(current, nextUsableStep(0));
+}
+
+void ReconnectManager::update() {
+    uint8_t current = step.load();
+    if (current == STEP_CONNECTED) {
+        account(STEP_CONNECTED);
+        return;
+    }
+    
+    // Advertising restarts here rather than in the BLE task callback
+    if (current == STEP_DISCONNECTED) {
+        advance(current, nextUsableStep(0));
+        return;
+    }
+    
+    uint32_t duration = schedule[current].durationMs;
+    if (duration != 0 && millis() - stepStart >= duration && current + 1 < stepCount) {
+        advance(current, nextUsableStep(current + 1));
+    }
+}
+
+uint8_t ReconnectManager::nextUsableStep(uint8_t from) {
+    // Steps aimed at the bonded host need one
+    while (from + 1 < stepCount && !hasHost && schedule[from].type != ADV_OPEN) {
+        from++;
+    }
+    return from;
+}
+
+void ReconnectManager::startStep(uint8_t index) {
+    step.store(index);
+    beginAdvertising(index);
+}
+
+void ReconnectManager::advance(uint8_t from, uint8_t to) {
+    // Fails when the host connected since update() looked at the step
+    uint8_t expected = from;
+    if (step.compare_exchange_strong(expected, to)) {
+        beginAdvertising(to);
+    }
+}
+
+void ReconnectManager::beginAdvertising(uint8_t index) {
+    const AdvertisingStep& entry = schedule[index];
+    account(index);
+    stepStart = millis();
+    
+    esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, entry.txPower);
+    if (entry.type == ADV_DIRECTED) {
+        startDirected();
+    } else {
+        startUndirected(entry);
+    }
+    
+    uint32_t permille = estimateDutyPermille(entry);
+    Serial.printf("Reconnect: %s advertising, radio ~%lu.%lu%%\n", entry.name,
+                  (unsigned long)(permille / 10), (unsigned long)(permille % 10));
+}
+
+void ReconnectManager::startDirected() {
+    esp_ble_adv_params_t params = {};
+    params.adv_int_min = 0x20;  // Ignored for high duty cycle
+    params.adv_int_max = 0x20;
+    params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+    params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+    memcpy(params.peer_addr, hostAddress, sizeof(params.peer_addr));
+    params.peer_addr_type = hostAddressType;
+    params.channel_map = ADV_CHNL_ALL;
+    params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+    
+    BLEDevice::stopAdvertising();
+    esp_ble_gap_start_advertising(&params);
+}
+
+void ReconnectManager::startUndirected(const AdvertisingStep& entry) {
+    BLEDevice::stopAdvertising();
+    pAdvertising->setMinInterval(entry.minInterval);
+    pAdvertising->setMaxInterval(entry.maxInterval);
+    pAdvertising->setScanFilter(false, entry.type == ADV_WHITELIST);
+    pAdvertising->start();
+}
+
+void ReconnectManager::account(uint8_t newStep) {
+    if (newStep == runningStep) return;
+    
+    unsigned long now = millis();
+    if (runningStep != STEP_CONNECTED) {
+        unsigned long elapsed = now - runningSince;
+        advertisingMs += elapsed;
+        radioOnUs += (uint64_t)elapsed * estimateDutyPermille(schedule[runningStep]);
+    }
+    runningStep = newStep;
+    runningSince = now;
+}
+
+uint32_t ReconnectManager::estimateDutyPermille(const AdvertisingStep& entry) {
+    // High duty directed advertising repeats every 3.75 ms at most
+    if (entry.type == ADV_DIRECTED) {
+        return ADV_EVENT_RADIO_US * 1000 / 3750;
+    }
+    uint32_t intervalUs = (uint32_t)(entry.minInterval + entry.maxInterval) * 625 / 2 + ADV_DELAY_AVG_US;
+    return ADV_EVENT_RADIO_US * 1000 / intervalUs;
+}
+
+uint8_t ReconnectManager::getStep() {
+    return step.load();
+}
+
+void ReconnectManager::onConnect() {
+    uint8_t previous = step.exchange(STEP_CONNECTED);
+    if (previous == STEP_CONNECTED) return;
+    
+    ReconnectEvent& event = history[historyNext];
+    event.durationMs = millis() - disconnectTime.load();
+    event.step = previous;
+    historyNext = (historyNext + 1) % HISTORY_SIZE;
+    if (historyCount < HISTORY_SIZE) historyCount++;
+    
+    Serial.printf("Reconnect: host back after %lu ms (%s)\n",
+                  (unsigned long)event.durationMs, stepName(previous));
+}
+
+void ReconnectManager::onDisconnect() {
+    disconnectTime.store(millis());
+    step.store(STEP_DISCONNECTED);
+}
+
+void ReconnectManager::onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+    if (event != ESP_GAP_BLE_AUTH_CMPL_EVT) return;
+    
+    if (!param->ble_security.auth_cmpl.success) {
+        Serial.printf("Reconnect: pairing failed (reason 0x%02X)\n",
+                      param->ble_security.auth_cmpl.fail_reason);
+        return;
+    }
+    storeHost(param->ble_security.auth_cmpl.bd_addr, param->ble_security.auth_cmpl.addr_type);
+}
+
+void ReconnectManager::storeHost(const esp_bd_addr_t address, esp_ble_addr_type_t addressType) {
+    // Identity addresses only, an RPA here means the IRK was not exchanged
+    if (addressType == BLE_ADDR_TYPE_RPA_PUBLIC || addressType == BLE_ADDR_TYPE_RPA_RANDOM) {
+        addressType = BLE_ADDR_TYPE_RANDOM;
+    }
+    if (hasHost && memcmp(address, hostAddress, sizeof(hostAddress)) == 0) return;
+    
+    // The whitelist only ever holds the last host
+    if (hasHost) {
+        esp_ble_gap_update_whitelist(false, hostAddress,
+                                     hostAddressType == BLE_ADDR_TYPE_PUBLIC ? BLE_WL_ADDR_TYPE_PUBLIC
+                                                                             : BLE_WL_ADDR_TYPE_RANDOM);
+    }
+    memcpy(hostAddress, address, sizeof(hostAddress));
+    hostAddressType = addressType;
+    hasHost = true;
+    esp_ble_gap_update_whitelist(true, hostAddress,
+                                 hostAddressType == BLE_ADDR_TYPE_PUBLIC ? BLE_WL_ADDR_TYPE_PUBLIC
+                                                                         : BLE_WL_ADDR_TYPE_RANDOM);
+    
+    prefs.putBytes("host", hostAddress, sizeof(hostAddress));
+    prefs.putUChar("hostType", hostAddressType);
+    Serial.println("Reconnect: new host bonded");
+}
+
+void ReconnectManager::clearBonds() {
+    int count = esp_ble_get_bond_device_num();
+    if (count > 0) {
+        esp_ble_bond_dev_t* devices = (esp_ble_bond_dev_t*)malloc(sizeof(esp_ble_bond_dev_t) * count);
+        if (devices && esp_ble_get_bond_device_list(&count, devices) == ESP_OK) {
+            for (int i = 0; i < count; i++) {
+                esp_ble_remove_bond_device(devices[i].bd_addr);
+            }
+        }
+        free(devices);
+    }
+    
+    esp_ble_gap_clear_whitelist();
+    prefs.clear();
+    hasHost = false;
+}
+
+const char* ReconnectManager::stepName(uint8_t index) {
+    if (index == STEP_CONNECTED) return "connected";
+    if (index == STEP_DISCONNECTED) return "disconnected";
+    if (index >= stepCount) return "?";
+    return schedule[index].name;
+}
+
+void ReconnectManager::printStats() {
+    uint8_t current = step.load();
+    Serial.printf("Reconnect: %s, %s\n", stepName(current),
+                  hasHost ? "bonded host known" : "no bonded host");
+    
+    // Include the step still running
+    uint64_t totalMs = advertisingMs;
+    uint64_t totalRadioUs = radioOnUs;
+    if (runningStep != STEP_CONNECTED) {
+        unsigned long elapsed = millis() - runningSince;
+        totalMs += elapsed;
+        totalRadioUs += (uint64_t)elapsed * estimateDutyPermille(schedule[runningStep]);
+    }
+    // ms x permille is microseconds of radio time
+    uint32_t avgPermille = totalMs ? (uint32_t)(totalRadioUs / totalMs) : 0;
+    Serial.printf("Advertising: %lu s total, radio on ~%lu ms (%lu.%lu%% average)\n",
+                  (unsigned long)(totalMs / 1000), (unsigned long)(totalRadioUs / 1000),
+                  (unsigned long)(avgPermille / 10), (unsigned long)(avgPermille % 10));
+    
+    // Oldest first
+    for (uint8_t i = 0; i < historyCount; i++) {
+        const ReconnectEvent& event = history[(historyNext + HISTORY_SIZE - historyCount + i) % HISTORY_SIZE];
+        Serial.printf("  reconnect %d: %lu ms (%s)\n", i + 1,
+                      (unsigned long)event.durationMs, stepName(event.step));
+    }
+}
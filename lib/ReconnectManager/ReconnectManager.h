@@ -0,0 +1,124 @@
+/*
+ * Reconnect Manager Module
+ * Bonding, whitelist and a phased advertising schedule
+ *
+ * Pairing bonds with encryption and identity keys, so Bluedroid keeps the
+ * LTK and the host's IRK in NVS and can resolve its private addresses.
+ * The identity address of the last bonded host is kept in Preferences.
+ *
+ * After a disconnect (or at boot) advertising walks through a schedule of
+ * steps given to begin(), typically:
+ *   directed   high-duty directed advertising at the last host, 1.28 s max
+ *   whitelist  fast undirected advertising, connections from the last host only
+ *   fast/...   undirected advertising, any host, slower and quieter each step
+ * Each step has its own interval, TX power and duration; the last one runs
+ * until a host connects. Steps aimed at the bonded host are skipped when
+ * there is none. A button press restarts the schedule once it has slowed
+ * down.
+ *
+ * The BLE task only marks a disconnect (step STEP_DISCONNECTED and the
+ * time, both atomic). update() on the loop task moves from there to the
+ * first step, with a compare-exchange so a host that is already back wins.
+ *
+ * The radio duty cycle of each step is estimated so a pedal left unpaired
+ * in its case can be checked against the battery. The time from disconnect
+ * to connect is recorded per event with the step that got the host back.
+ */
+
+#ifndef RECONNECT_MANAGER_H
+#define RECONNECT_MANAGER_H
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLESecurity.h>
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+#include <esp_bt.h>
+#include <atomic>
+
+enum AdvertisingType {
+    ADV_DIRECTED,   // High duty cycle, bonded host only
+    ADV_WHITELIST,  // Undirected, connections from the bonded host only
+    ADV_OPEN        // Undirected, any host may connect and pair
+};
+
+struct AdvertisingStep {
+    const char* name;
+    AdvertisingType type;
+    uint16_t minInterval;       // 0.625 ms units
+    uint16_t maxInterval;
+    esp_power_level_t txPower;
+    uint32_t durationMs;        // 0 = until a host connects
+};
+
+struct ReconnectEvent {
+    uint32_t durationMs;  // Disconnect (or boot) to connect
+    uint8_t step;         // Schedule step that was advertising when the host came back
+};
+
+class ReconnectManager {
+public:
+    static const uint8_t STEP_CONNECTED = 0xFF;
+    static const uint8_t STEP_DISCONNECTED = 0xFE;  // Advertising not restarted yet
+    static const uint8_t HISTORY_SIZE = 8;
+    static const uint32_t ADV_EVENT_RADIO_US = 1500;  // 3 channels TX + scan request windows
+    static const uint32_t ADV_DELAY_AVG_US = 5000;    // Random 0-10 ms added per event
+
+private:
+    Preferences prefs;
+    BLEAdvertising* pAdvertising;
+    const AdvertisingStep* schedule;
+    uint8_t stepCount;
+    uint8_t firstOpenStep;
+
+    // Last bonded host, identity address
+    bool hasHost;
+    esp_bd_addr_t hostAddress;
+    esp_ble_addr_type_t hostAddressType;
+
+    std::atomic<uint8_t> step;
+    std::atomic<unsigned long> disconnectTime;
+    unsigned long stepStart;  // Loop task only
+
+    // Duty cycle accounting, loop task only
+    uint8_t runningStep;
+    unsigned long runningSince;
+    uint64_t advertisingMs;
+    uint64_t radioOnUs;
+
+    ReconnectEvent history[HISTORY_SIZE];
+    uint8_t historyCount;
+    uint8_t historyNext;
+
+    uint8_t nextUsableStep(uint8_t from);
+    void startStep(uint8_t index);
+    void advance(uint8_t from, uint8_t to);
+    void beginAdvertising(uint8_t index);
+    void startDirected();
+    void startUndirected(const AdvertisingStep& entry);
+    void account(uint8_t newStep);
+    void storeHost(const esp_bd_addr_t address, esp_ble_addr_type_t addressType);
+    uint32_t estimateDutyPermille(const AdvertisingStep& entry);
+    const char* stepName(uint8_t index);
+
+public:
+    ReconnectManager();
+    void begin(BLEAdvertising* advertising, const AdvertisingStep* steps, uint8_t count);
+
+    // Loop task
+    void start();
+    void startPairing();
+    void onActivity();
+    void update();
+    void clearBonds();
+
+    // BLE task
+    void onConnect();
+    void onDisconnect();
+    void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+    uint8_t getStep();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Render Task Module Implementation
+ */
+
+#include "RenderTask.h"
+#include <esp_timer.h>
+
+RenderTask::RenderTask() {
+    memset(frames, 0, sizeof(frames));
+    memset(publishUs, 0, sizeof(publishUs));
+    frameSize = 0;
+    backSlot = 0;
+    frontSlot = 1;
+    pending.store(2);
+    publishLock = portMUX_INITIALIZER_UNLOCKED;
+    render = nullptr;
+    renderContext = nullptr;
+    deadlineUs = 0;
+    task = nullptr;
+    publishedCount.store(0);
+    renderedCount.store(0);
+    droppedCount.store(0);
+    lateCount.store(0);
+    maxLatencyUs = 0;
+    renderTimeUs = 0;
+}
+
+bool RenderTask::begin(uint8_t size, RenderFunction function, void* context, uint32_t deadlineMs,
+                       BaseType_t core, UBaseType_t priority) {
+    frameSize = size > MAX_FRAME_SIZE ? MAX_FRAME_SIZE : size;
+    render = function;
+    renderContext = context;
+    deadlineUs = deadlineMs * 1000;
+
+    BaseType_t result = xTaskCreatePinnedToCore(taskEntry, "render", TASK_STACK_SIZE,
+                                                this, priority, &task, core);
+    if (result != pdPASS) {
+        Serial.println("Render task creation failed, drawing inline");
+        task = nullptr;
+        return false;
+    }
+
+    Serial.printf("Render task started on core %d, priority %d\n", (int)core, (int)priority);
+    return true;
+}
+
+void RenderTask::publish(const uint8_t* frame) {
+    if (!render) return;
+
+    if (!task) {
+        publishedCount.fetch_add(1, std::memory_order_relaxed);
+        memcpy(frames[backSlot], frame, frameSize);
+        publishUs[backSlot] = esp_timer_get_time();
+        draw(backSlot);
+        return;
+    }
+
+    portENTER_CRITICAL(&publishLock);
+    publishedCount.fetch_add(1, std::memory_order_relaxed);
+    memcpy(frames[backSlot], frame, frameSize);
+    publishUs[backSlot] = esp_timer_get_time();
+
+    // The previous pending frame becomes the next back buffer
+    uint8_t previous = pending.exchange(backSlot | SLOT_FRESH, std::memory_order_acq_rel);
+    if (previous & SLOT_FRESH) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    backSlot = previous & SLOT_MASK;
+    portEXIT_CRITICAL(&publishLock);
+
+    xTaskNotifyGive(task);
+}
+
+void RenderTask::taskEntry(void* arg) {
+    static_cast<RenderTask*>(arg)->run();
+}
+
+void RenderTask::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Already taken on an earlier wake-up
+        if (!(pending.load(std::memory_order_acquire) & SLOT_FRESH)) continue;
+
+        uint8_t next = pending.exchange(frontSlot, std::memory_order_acq_rel);
+        frontSlot = next & SLOT_MASK;
+        draw(frontSlot);
+    }
+}
+
+void RenderTask::draw(uint8_t slot) {
+    int64_t start = esp_timer_get_time();
+    render(frames[slot], renderContext);
+    int64_t end = esp_timer_get_time();
+
+    renderTimeUs += end - start;
+    uint32_t latencyUs = (uint32_t)(end - publishUs[slot]);
+    if (latencyUs > maxLatencyUs) {
+        maxLatencyUs = latencyUs;
+    }
+    if (latencyUs > deadlineUs) {
+        lateCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    renderedCount.fetch_add(1, std::memory_order_release);
+}
+
+bool RenderTask::waitIdle(uint32_t timeoutMs) {
+    // Every published frame ends up either drawn or dropped
+    uint32_t start = millis();
+    while (renderedCount.load(std::memory_order_acquire) + droppedCount.load() !=
+           publishedCount.load()) {
+        if (millis() - start >= timeoutMs) return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+bool RenderTask::hasPendingFrame() {
+    return pending.load(std::memory_order_acquire) & SLOT_FRESH;
+}
+
+uint32_t RenderTask::getDroppedCount() {
+    return droppedCount.load();
+}
+
+uint32_t RenderTask::getLateCount() {
+    return lateCount.load();
+}
+
+void RenderTask::printStats() {
+    uint32_t rendered = renderedCount.load();
+    Serial.printf("Render: %lu published, %lu drawn, %lu dropped, %lu late (> %lu ms)\n",
+                  (unsigned long)publishedCount.load(), (unsigned long)rendered,
+                  (unsigned long)droppedCount.load(), (unsigned long)lateCount.load(),
+                  (unsigned long)(deadlineUs / 1000));
+    Serial.printf("Render: max latency %lu us, avg draw %lu us\n", (unsigned long)maxLatencyUs,
+                  (unsigned long)(rendered ? renderTimeUs / rendered : 0));
+}
@@ -0,0 +1,79 @@
+/*
+ * Render Task Module
+ * Display drawing on its own task, fed by double-buffered frames
+ *
+ * The control logic composes a whole frame and publish()es it: the frame
+ * is copied into the back buffer, which is swapped atomically with the
+ * pending slot. The render task swaps the pending slot with its front
+ * buffer and draws it. A third slot is what lets both swaps be a single
+ * exchange: neither side ever waits for the other, so a slow display bus
+ * never holds up a button scan or a notify.
+ *
+ * Only the newest frame matters. A frame replaced before the task got to
+ * it is counted as dropped, one drawn later than the deadline after its
+ * publish() as late.
+ *
+ * Producers on several tasks (loop(), a timer) are fine: a spinlock
+ * keeps the back buffer to one of them for the copy and the swap.
+ */
+
+#ifndef RENDER_TASK_H
+#define RENDER_TASK_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class RenderTask {
+public:
+    typedef void (*RenderFunction)(const uint8_t* frame, void* context);  // Render task
+
+    static const uint8_t MAX_FRAME_SIZE = 32;
+    static const uint32_t TASK_STACK_SIZE = 4096;
+
+private:
+    static const uint8_t SLOT_MASK = 0x03;
+    static const uint8_t SLOT_FRESH = 0x80;  // Published, not drawn yet
+
+    uint8_t frames[3][MAX_FRAME_SIZE];
+    int64_t publishUs[3];
+    uint8_t frameSize;
+    uint8_t backSlot;                // Under publishLock
+    portMUX_TYPE publishLock;
+    uint8_t frontSlot;               // Render task only
+    std::atomic<uint8_t> pending;    // Slot index | SLOT_FRESH
+
+    RenderFunction render;
+    void* renderContext;
+    uint32_t deadlineUs;
+    TaskHandle_t task;
+
+    // Statistics
+    std::atomic<uint32_t> publishedCount;
+    std::atomic<uint32_t> renderedCount;
+    std::atomic<uint32_t> droppedCount;
+    std::atomic<uint32_t> lateCount;
+    uint32_t maxLatencyUs;
+    uint64_t renderTimeUs;
+
+    static void taskEntry(void* arg);
+    void run();
+    void draw(uint8_t slot);
+
+public:
+    RenderTask();
+    bool begin(uint8_t size, RenderFunction function, void* context, uint32_t deadlineMs,
+               BaseType_t core, UBaseType_t priority);
+
+    // Producer side, draws inline when the task is not running
+    void publish(const uint8_t* frame);
+    bool waitIdle(uint32_t timeoutMs);  // Last frame drawn (or dropped)
+
+    // Render task, lets a long draw give way to a newer frame
+    bool hasPendingFrame();
+
+    uint32_t getDroppedCount();
+    uint32_t getLateCount();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Timeline Module Implementation
+ */
+
+#include "Timeline.h"
+
+Timeline::Timeline() {
+    for (uint8_t i = 0; i < MAX_PLAYING; i++) {
+        slots[i].animation = nullptr;
+        slots[i].startMs = 0;
+        slots[i].order = 0;
+        slots[i].onDone = nullptr;
+    }
+    for (uint8_t i = 0; i < MAX_OUTPUTS; i++) {
+        outputValues[i] = RELEASE;
+    }
+    nextOrder = 1;
+    writeOutput = nullptr;
+    nextDueMs = 0;
+    hasNextDue = false;
+    due = false;
+    startCount = 0;
+    refusedCount = 0;
+    writeCount = 0;
+}
+
+void Timeline::begin(OutputFunction output) {
+    writeOutput = output;
+}
+
+Timeline::Slot* Timeline::find(const Animation* animation) {
+    // nullptr finds a free slot
+    for (uint8_t i = 0; i < MAX_PLAYING; i++) {
+        if (slots[i].animation == animation) return &slots[i];
+    }
+    return nullptr;
+}
+
+bool Timeline::play(const Animation& animation, DoneFunction onDone) {
+    Slot* slot = find(&animation);
+    if (!slot) {
+        slot = find(nullptr);
+    }
+    if (!slot) {
+        refusedCount++;
+        return false;
+    }
+
+    slot->animation = &animation;
+    slot->startMs = millis();
+    slot->order = nextOrder++;
+    slot->onDone = onDone;
+    startCount++;
+    due = true;
+    return true;
+}
+
+void Timeline::stop(const Animation& animation) {
+    Slot* slot = find(&animation);
+    if (!slot) return;
+
+    slot->animation = nullptr;
+    slot->onDone = nullptr;
+    due = true;
+}
+
+bool Timeline::isPlaying(const Animation& animation) {
+    return find(&animation) != nullptr;
+}
+
+uint8_t Timeline::valueAt(const TimelineTrack& track, uint32_t elapsedMs, uint32_t& untilNextMs) {
+    uint32_t t = elapsedMs;
+    uint8_t value = track.keys[0].value;
+    untilNextMs = UINT32_MAX;
+
+    if (track.periodMs != 0) {
+        // Before the first keyframe of a cycle the previous cycle still holds
+        t %= track.periodMs;
+        value = track.keys[track.keyCount - 1].value;
+        untilNextMs = track.periodMs - t + track.keys[0].timeMs;
+    }
+
+    for (uint8_t i = 0; i < track.keyCount; i++) {
+        if (track.keys[i].timeMs > t) {
+            untilNextMs = track.keys[i].timeMs - t;
+            break;
+        }
+        value = track.keys[i].value;
+    }
+    return value;
+}
+
+void Timeline::update(uint32_t nowMs) {
+    uint8_t values[MAX_OUTPUTS];
+    uint32_t owners[MAX_OUTPUTS];
+    for (uint8_t i = 0; i < MAX_OUTPUTS; i++) {
+        values[i] = RELEASE;
+        owners[i] = 0;
+    }
+
+    DoneFunction finished[MAX_PLAYING];
+    uint8_t finishedCount = 0;
+    uint32_t untilDue = UINT32_MAX;
+
+    for (uint8_t s = 0; s < MAX_PLAYING; s++) {
+        Slot& slot = slots[s];
+        if (!slot.animation) continue;
+
+        const Animation& animation = *slot.animation;
+        uint32_t elapsed = nowMs - slot.startMs;
+        if (animation.durationMs != 0) {
+            if (elapsed >= animation.durationMs) {
+                // Callbacks run once the outputs are settled, they may play more
+                if (slot.onDone) {
+                    finished[finishedCount++] = slot.onDone;
+                }
+                slot.animation = nullptr;
+                slot.onDone = nullptr;
+                continue;
+            }
+            if (animation.durationMs - elapsed < untilDue) {
+                untilDue = animation.durationMs - elapsed;
+            }
+        }
+
+        for (uint8_t k = 0; k < animation.trackCount; k++) {
+            const TimelineTrack& track = animation.tracks[k];
+            if (track.output >= MAX_OUTPUTS || track.keyCount == 0) continue;
+
+            uint32_t untilNext;
+            uint8_t value = valueAt(track, elapsed, untilNext);
+            if (slot.order > owners[track.output]) {
+                owners[track.output] = slot.order;
+                values[track.output] = value;
+            }
+            if (untilNext < untilDue) {
+                untilDue = untilNext;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < MAX_OUTPUTS; i++) {
+        if (values[i] == outputValues[i]) continue;
+        outputValues[i] = values[i];
+        writeCount++;
+        if (writeOutput) {
+            writeOutput(i, values[i]);
+        }
+    }
+
+    due = false;
+    hasNextDue = (untilDue != UINT32_MAX);
+    nextDueMs = nowMs + untilDue;
+
+    for (uint8_t i = 0; i < finishedCount; i++) {
+        finished[i]();
+    }
+}
+
+uint32_t Timeline::getNextUpdateMs(uint32_t nowMs) {
+    if (due) return 0;
+    if (!hasNextDue) return UINT32_MAX;
+
+    int32_t remaining = (int32_t)(nextDueMs - nowMs);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+void Timeline::printStats() {
+    Serial.printf("Timeline: %lu started, %lu refused (all %u slots busy), %lu output writes\n",
+                  (unsigned long)startCount, (unsigned long)refusedCount, MAX_PLAYING,
+                  (unsigned long)writeCount);
+    for (uint8_t i = 0; i < MAX_PLAYING; i++) {
+        if (slots[i].animation) {
+            Serial.printf("Timeline: playing %s for %lu ms\n", slots[i].animation->name,
+                          (unsigned long)(millis() - slots[i].startMs));
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Timeline Module
+ * Cooperative keyframe animations for LEDs and the display
+ *
+ * An animation is a set of tracks. Each track steps one output (an LED,
+ * the display) through keyframe values at fixed offsets from the start of
+ * the animation, once or in a loop. update() runs from loop(): it looks up
+ * the current keyframe of every playing track and only writes the outputs
+ * whose value changed, so a pass costs a few comparisons and never blocks
+ * the footswitches, the MIDI path or the BLE stack. getNextUpdateMs() tells
+ * loop() how long it may wait before the next keyframe is due.
+ *
+ * Several animations play at once. When two drive the same output, the
+ * one started last owns it; once it ends, the output goes back to the
+ * previous owner, or is handed back to the firmware with RELEASE so it
+ * can show its resting state.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <Arduino.h>
+
+struct Keyframe {
+    uint16_t timeMs;  // Offset in the track, the first keyframe at 0
+    uint8_t value;    // LED level or frame number, meaning set by the output
+};
+
+struct TimelineTrack {
+    uint8_t output;
+    const Keyframe* keys;
+    uint8_t keyCount;
+    uint16_t periodMs;  // Loop length, 0 = play once and hold the last value
+};
+
+struct Animation {
+    const char* name;
+    const TimelineTrack* tracks;
+    uint8_t trackCount;
+    uint32_t durationMs;  // 0 = until stopped
+};
+
+class Timeline {
+public:
+    static const uint8_t MAX_PLAYING = 4;
+    static const uint8_t MAX_OUTPUTS = 8;
+    static const uint8_t RELEASE = 0xFF;  // Output value when no animation owns it
+
+    typedef void (*OutputFunction)(uint8_t output, uint8_t value);
+    typedef void (*DoneFunction)();
+
+private:
+    struct Slot {
+        const Animation* animation;  // nullptr when free
+        uint32_t startMs;
+        uint32_t order;  // Start order, the newest owns shared outputs
+        DoneFunction onDone;
+    };
+
+    Slot slots[MAX_PLAYING];
+    uint32_t nextOrder;
+    OutputFunction writeOutput;
+    uint8_t outputValues[MAX_OUTPUTS];  // Last value written
+    uint32_t nextDueMs;
+    bool hasNextDue;  // A keyframe or an end is ahead
+    bool due;         // Something changed since the last update()
+
+    // Statistics
+    uint32_t startCount;
+    uint32_t refusedCount;
+    uint32_t writeCount;
+
+    Slot* find(const Animation* animation);
+    static uint8_t valueAt(const TimelineTrack& track, uint32_t elapsedMs, uint32_t& untilNextMs);
+
+public:
+    Timeline();
+    void begin(OutputFunction output);
+
+    // Restarts the animation when it is already playing, onDone runs from
+    // update() when a timed animation ends (not when stopped)
+    bool play(const Animation& animation, DoneFunction onDone = nullptr);
+    void stop(const Animation& animation);
+    bool isPlaying(const Animation& animation);
+
+    void update(uint32_t nowMs);
+    uint32_t getNextUpdateMs(uint32_t nowMs);  // UINT32_MAX when nothing changes
+    void printStats();
+};
+
+#endif
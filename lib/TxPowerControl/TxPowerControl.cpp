@@ -0,0 +1,194 @@
+/*
+ * TX Power Control Module Implementation
+ */
+
+#include "TxPowerControl.h"
+
+TxPowerControl::TxPowerControl() {
+    minLevel = ESP_PWR_LVL_N12;
+    maxLevel = ESP_PWR_LVL_P9;
+    memset(peerAddress, 0, sizeof(peerAddress));
+    connected.store(false);
+    connectPending.store(false);
+    troublePending.store(false);
+    sampleReady.store(false);
+    lastRssi.store(0);
+    readFailCount.store(0);
+    active = false;
+    level = maxLevel;
+    smoothedRssi = 0;
+    haveSample = false;
+    goodSamples = 0;
+    lastRequest = 0;
+    lastChange = 0;
+    levelSince = 0;
+    memset(msAtLevel, 0, sizeof(msAtLevel));
+    raiseCount = 0;
+    lowerCount = 0;
+}
+
+void TxPowerControl::begin(esp_power_level_t minimum, esp_power_level_t maximum) {
+    minLevel = minimum;
+    maxLevel = maximum;
+    level = maxLevel;
+}
+
+void TxPowerControl::onConnect(const esp_ble_gatts_cb_param_t* param) {
+    memcpy(peerAddress, param->connect.remote_bda, sizeof(peerAddress));
+    connected.store(true);
+    connectPending.store(true);
+}
+
+void TxPowerControl::onDisconnect() {
+    connected.store(false);
+}
+
+void TxPowerControl::onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+    if (event != ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT) return;
+    
+    if (param->read_rssi_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+        readFailCount.fetch_add(1);
+        return;
+    }
+    lastRssi.store(param->read_rssi_cmpl.rssi);
+    sampleReady.store(true);
+}
+
+void TxPowerControl::onLinkTrouble() {
+    troublePending.store(true);
+}
+
+void TxPowerControl::update() {
+    unsigned long now = millis();
+    
+    if (connectPending.exchange(false)) {
+        // Start every connection at full power, the first samples bring it down
+        active = true;
+        haveSample = false;
+        goodSamples = 0;
+        troublePending.store(false);
+        sampleReady.store(false);
+        lastRequest = now - SAMPLE_PERIOD_MS;
+        levelSince = now;
+        setLevel(maxLevel, now);
+    }
+    
+    if (!connected.load()) {
+        if (active) {
+            account(now);
+            active = false;
+        }
+        return;
+    }
+    if (!active) return;
+    
+    if (troublePending.exchange(false) && level < maxLevel) {
+        Serial.println("TX power: notify failed, back to maximum");
+        raiseCount++;
+        goodSamples = 0;
+        setLevel(maxLevel, now);
+    }
+    
+    if (sampleReady.exchange(false)) {
+        process(lastRssi.load(), now);
+    }
+    
+    if (now - lastRequest >= SAMPLE_PERIOD_MS) {
+        lastRequest = now;
+        esp_ble_gap_read_rssi(peerAddress);
+    }
+}
+
+void TxPowerControl::process(int rssi, unsigned long now) {
+    if (haveSample) {
+        smoothedRssi += (rssi * 4 - smoothedRssi) / 4;
+    } else {
+        smoothedRssi = rssi * 4;
+        haveSample = true;
+    }
+    int average = smoothedRssi / 4;
+    
+    // Raise on the worse of the sample and the average, before packets are lost
+    int worst = rssi < average ? rssi : average;
+    if (estimateAtHost(level, worst) < TARGET_HOST_RSSI_DBM) {
+        uint8_t needed = level;
+        while (needed < maxLevel && estimateAtHost(needed, worst) < TARGET_HOST_RSSI_DBM) {
+            needed++;
+        }
+        goodSamples = 0;
+        if (needed != level) {
+            raiseCount++;
+            setLevel(needed, now);
+        }
+        return;
+    }
+    
+    // Lower one step only with margin to spare at the lower level
+    if (level > minLevel &&
+        estimateAtHost(level - 1, average) >= TARGET_HOST_RSSI_DBM + LOWER_MARGIN_DB) {
+        goodSamples++;
+    } else {
+        goodSamples = 0;
+    }
+    
+    if (goodSamples >= LOWER_SAMPLES && now - lastChange >= LOWER_HOLD_MS) {
+        goodSamples = 0;
+        lowerCount++;
+        setLevel(level - 1, now);
+    }
+}
+
+void TxPowerControl::setLevel(uint8_t newLevel, unsigned long now) {
+    account(now);
+    level = newLevel;
+    lastChange = now;
+    
+    // A single peripheral link, the controller gives it handle 0
+    esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_CONN_HDL0, (esp_power_level_t)level);
+    if (haveSample) {
+        Serial.printf("TX power: %+d dBm (RSSI avg %d dBm)\n", levelToDbm(level), smoothedRssi / 4);
+    } else {
+        Serial.printf("TX power: %+d dBm\n", levelToDbm(level));
+    }
+}
+
+void TxPowerControl::account(unsigned long now) {
+    msAtLevel[level] += now - levelSince;
+    levelSince = now;
+}
+
+int TxPowerControl::estimateAtHost(uint8_t atLevel, int rssi) {
+    // Path loss = host TX - RSSI, and the same loss on the way back
+    return levelToDbm(atLevel) - (ASSUMED_HOST_TX_DBM - rssi);
+}
+
+int TxPowerControl::levelToDbm(uint8_t level) {
+    return -12 + 3 * (int)level;
+}
+
+int TxPowerControl::getTxPowerDbm() {
+    return levelToDbm(level);
+}
+
+void TxPowerControl::printStats() {
+    Serial.printf("TX power: %+d dBm%s, RSSI avg %d dBm, %lu lowered / %lu raised, %lu failed reads\n",
+                  levelToDbm(level), active ? "" : " (idle)", haveSample ? smoothedRssi / 4 : 0,
+                  (unsigned long)lowerCount, (unsigned long)raiseCount,
+                  (unsigned long)readFailCount.load());
+    
+    // Include the time at the current level
+    uint64_t times[LEVEL_COUNT];
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        times[i] = msAtLevel[i];
+        if (active && i == level) times[i] += millis() - levelSince;
+        total += times[i];
+    }
+    if (total == 0) return;
+    
+    for (uint8_t i = LEVEL_COUNT; i-- > 0;) {
+        if (times[i] == 0) continue;
+        Serial.printf("  %+3d dBm: %lu s (%lu%%)\n", levelToDbm(i),
+                      (unsigned long)(times[i] / 1000), (unsigned long)(times[i] * 100 / total));
+    }
+}
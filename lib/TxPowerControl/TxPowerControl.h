@@ -0,0 +1,91 @@
+/*
+ * TX Power Control Module
+ * RSSI-driven BLE transmit power with hysteresis
+ *
+ * While connected the RSSI of the link is read every SAMPLE_PERIOD_MS.
+ * The host's own TX power is unknown, so the path loss is estimated
+ * assuming a typical 0 dBm host and the link is taken to be symmetric:
+ * what the host receives from us is our TX power minus that path loss.
+ *
+ * Power goes up at once, using the worse of the last sample and the
+ * average, as soon as the estimate at the host drops below the target. It
+ * goes down one 3 dB step at a time, and only after LOWER_SAMPLES samples
+ * in a row that would still clear the target by LOWER_MARGIN_DB at the
+ * lower level, and not within LOWER_HOLD_MS of the last change. A failed
+ * notification jumps straight back to the maximum.
+ *
+ * Each connection starts at the maximum. Time spent at each level is
+ * recorded so the battery gain can be checked against dropouts.
+ */
+
+#ifndef TX_POWER_CONTROL_H
+#define TX_POWER_CONTROL_H
+
+#include <Arduino.h>
+#include <esp_bt.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+#include <atomic>
+
+class TxPowerControl {
+public:
+    static const uint8_t LEVEL_COUNT = 8;                // ESP_PWR_LVL_N12 .. ESP_PWR_LVL_P9
+    static const unsigned long SAMPLE_PERIOD_MS = 1000;
+    static const int ASSUMED_HOST_TX_DBM = 0;
+    static const int TARGET_HOST_RSSI_DBM = -70;         // About 20 dB above sensitivity
+    static const int LOWER_MARGIN_DB = 6;
+    static const uint8_t LOWER_SAMPLES = 5;
+    static const unsigned long LOWER_HOLD_MS = 5000;
+
+private:
+    uint8_t minLevel;
+    uint8_t maxLevel;
+
+    // Written from the BLE task
+    esp_bd_addr_t peerAddress;
+    std::atomic<bool> connected;
+    std::atomic<bool> connectPending;
+    std::atomic<bool> troublePending;
+    std::atomic<bool> sampleReady;
+    std::atomic<int> lastRssi;
+    std::atomic<uint32_t> readFailCount;
+
+    // Loop task only
+    bool active;
+    uint8_t level;
+    int smoothedRssi;  // Quarter dB
+    bool haveSample;
+    uint8_t goodSamples;
+    unsigned long lastRequest;
+    unsigned long lastChange;
+    unsigned long levelSince;
+
+    // Statistics
+    uint64_t msAtLevel[LEVEL_COUNT];
+    uint32_t raiseCount;
+    uint32_t lowerCount;
+
+    void process(int rssi, unsigned long now);
+    void setLevel(uint8_t newLevel, unsigned long now);
+    void account(unsigned long now);
+    static int estimateAtHost(uint8_t atLevel, int rssi);
+
+public:
+    TxPowerControl();
+    void begin(esp_power_level_t minimum, esp_power_level_t maximum);
+
+    // BLE task
+    void onConnect(const esp_ble_gatts_cb_param_t* param);
+    void onDisconnect();
+    void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+    void onLinkTrouble();
+
+    // Loop task
+    void update();
+
+    static int levelToDbm(uint8_t level);
+    int getTxPowerDbm();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Glyph Atlas Module Implementation
+ */
+
+#include "GlyphAtlas.h"
+
+// A 3x5 glyph is five 3-bit rows, the top one in the high bits
+static constexpr uint16_t glyph(uint8_t r0, uint8_t r1, uint8_t r2, uint8_t r3, uint8_t r4) {
+    return (r0 << 12) | (r1 << 9) | (r2 << 6) | (r3 << 3) | r4;
+}
+
+// ' ' to 'Z', characters without a glyph are blank
+static constexpr uint16_t FONT[] = {
+    0,                                         // space
+    glyph(0b010, 0b010, 0b010, 0b000, 0b010),  // !
+    0,
+    glyph(0b101, 0b111, 0b101, 0b111, 0b101),  // #
+    0, 0, 0, 0, 0, 0, 0,
+    glyph(0b000, 0b010, 0b111, 0b010, 0b000),  // +
+    glyph(0b000, 0b000, 0b000, 0b010, 0b100),  // ,
+    glyph(0b000, 0b000, 0b111, 0b000, 0b000),  // -
+    glyph(0b000, 0b000, 0b000, 0b000, 0b010),  // .
+    glyph(0b001, 0b001, 0b010, 0b100, 0b100),  // /
+    glyph(0b111, 0b101, 0b101, 0b101, 0b111),  // 0
+    glyph(0b010, 0b110, 0b010, 0b010, 0b111),  // 1
+    glyph(0b111, 0b001, 0b111, 0b100, 0b111),  // 2
+    glyph(0b111, 0b001, 0b111, 0b001, 0b111),  // 3
+    glyph(0b101, 0b101, 0b111, 0b001, 0b001),  // 4
+    glyph(0b111, 0b100, 0b111, 0b001, 0b111),  // 5
+    glyph(0b111, 0b100, 0b111, 0b101, 0b111),  // 6
+    glyph(0b111, 0b001, 0b001, 0b010, 0b010),  // 7
+    glyph(0b111, 0b101, 0b111, 0b101, 0b111),  // 8
+    glyph(0b111, 0b101, 0b111, 0b001, 0b111),  // 9
+    glyph(0b000, 0b010, 0b000, 0b010, 0b000),  // :
+    0, 0,
+    glyph(0b000, 0b111, 0b000, 0b111, 0b000),  // =
+    0,
+    glyph(0b111, 0b001, 0b010, 0b000, 0b010),  // ?
+    0,
+    glyph(0b010, 0b101, 0b111, 0b101, 0b101),  // A
+    glyph(0b110, 0b101, 0b110, 0b101, 0b110),  // B
+    glyph(0b011, 0b100, 0b100, 0b100, 0b011),  // C
+    glyph(0b110, 0b101, 0b101, 0b101, 0b110),  // D
+    glyph(0b111, 0b100, 0b110, 0b100, 0b111),  // E
+    glyph(0b111, 0b100, 0b110, 0b100, 0b100),  // F
+    glyph(0b011, 0b100, 0b101, 0b101, 0b011),  // G
+    glyph(0b101, 0b101, 0b111, 0b101, 0b101),  // H
+    glyph(0b111, 0b010, 0b010, 0b010, 0b111),  // I
+    glyph(0b001, 0b001, 0b001, 0b101, 0b010),  // J
+    glyph(0b101, 0b101, 0b110, 0b101, 0b101),  // K
+    glyph(0b100, 0b100, 0b100, 0b100, 0b111),  // L
+    glyph(0b101, 0b111, 0b111, 0b101, 0b101),  // M
+    glyph(0b110, 0b101, 0b101, 0b101, 0b101),  // N
+    glyph(0b010, 0b101, 0b101, 0b101, 0b010),  // O
+    glyph(0b110, 0b101, 0b110, 0b100, 0b100),  // P
+    glyph(0b010, 0b101, 0b101, 0b110, 0b011),  // Q
+    glyph(0b110, 0b101, 0b110, 0b101, 0b101),  // R
+    glyph(0b011, 0b100, 0b010, 0b001, 0b110),  // S
+    glyph(0b111, 0b010, 0b010, 0b010, 0b010),  // T
+    glyph(0b101, 0b101, 0b101, 0b101, 0b111),  // U
+    glyph(0b101, 0b101, 0b101, 0b101, 0b010),  // V
+    glyph(0b101, 0b101, 0b111, 0b111, 0b101),  // W
+    glyph(0b101, 0b101, 0b010, 0b101, 0b101),  // X
+    glyph(0b101, 0b101, 0b010, 0b010, 0b010),  // Y
+    glyph(0b111, 0b001, 0b010, 0b100, 0b111)   // Z
+};
+static const char FONT_FIRST = ' ';
+static const char FONT_LAST = 'Z';
+static_assert(sizeof(FONT) / sizeof(FONT[0]) == FONT_LAST - FONT_FIRST + 1, "font covers ' '-'Z'");
+
+static constexpr uint16_t fontGlyph(char c) {
+    return (c >= 'a' && c <= 'z') ? fontGlyph(c - 'a' + 'A')
+         : (c >= FONT_FIRST && c <= FONT_LAST) ? FONT[c - FONT_FIRST]
+         : 0;
+}
+
+static constexpr uint16_t digitGlyph(uint8_t digit) {
+    return FONT['0' - FONT_FIRST + digit];
+}
+
+// Top glyph row first
+static constexpr uint8_t glyphBits(uint16_t g, uint8_t row) {
+    return (g >> (3 * (GlyphAtlas::GLYPH_HEIGHT - 1 - row))) & 0x07;
+}
+
+// One matrix row of a glyph whose left column is col
+static constexpr uint8_t place(uint16_t g, uint8_t row, uint8_t col) {
+    return (row < GlyphAtlas::GLYPH_TOP || row >= GlyphAtlas::GLYPH_TOP + GlyphAtlas::GLYPH_HEIGHT)
+        ? 0
+        : glyphBits(g, row - GlyphAtlas::GLYPH_TOP) << (5 - col);
+}
+
+// Two glyphs in columns 0-2 and 4-6
+static constexpr uint8_t pairRow(uint16_t left, uint16_t right, uint8_t row) {
+    return place(left, row, 0) | place(right, row, 4);
+}
+
+static constexpr MatrixFrame pairFrame(uint16_t left, uint16_t right) {
+    return MatrixFrame{{pairRow(left, right, 0), pairRow(left, right, 1),
+                        pairRow(left, right, 2), pairRow(left, right, 3),
+                        pairRow(left, right, 4), pairRow(left, right, 5),
+                        pairRow(left, right, 6), pairRow(left, right, 7)}};
+}
+
+// One glyph centered in columns 2-4
+static constexpr MatrixFrame glyphFrame(uint16_t g) {
+    return MatrixFrame{{place(g, 0, 2), place(g, 1, 2), place(g, 2, 2), place(g, 3, 2),
+                        place(g, 4, 2), place(g, 5, 2), place(g, 6, 2), place(g, 7, 2)}};
+}
+
+static constexpr MatrixFrame channelFrame(uint8_t number) {
+    return number < 10 ? pairFrame(fontGlyph('C'), digitGlyph(number))
+                       : pairFrame(digitGlyph(number / 10), digitGlyph(number % 10));
+}
+
+// Outline with the bottom rows filled, one row per level
+static constexpr uint8_t batteryRow(uint8_t level, uint8_t row) {
+    return (row == 0 || row >= 7 - level) ? 0xFF : 0x81;
+}
+
+static constexpr MatrixFrame batteryFrame(uint8_t level) {
+    return MatrixFrame{{batteryRow(level, 0), batteryRow(level, 1), batteryRow(level, 2),
+                        batteryRow(level, 3), batteryRow(level, 4), batteryRow(level, 5),
+                        batteryRow(level, 6), batteryRow(level, 7)}};
+}
+
+static constexpr MatrixFrame CHANNEL_FRAMES[GlyphAtlas::MAX_CHANNEL] = {
+    channelFrame(1),  channelFrame(2),  channelFrame(3),  channelFrame(4),
+    channelFrame(5),  channelFrame(6),  channelFrame(7),  channelFrame(8),
+    channelFrame(9),  channelFrame(10), channelFrame(11), channelFrame(12),
+    channelFrame(13), channelFrame(14), channelFrame(15), channelFrame(16)
+};
+
+static constexpr MatrixFrame BATTERY_FRAMES[GlyphAtlas::BATTERY_LEVELS] = {
+    batteryFrame(0), batteryFrame(1), batteryFrame(2),
+    batteryFrame(3), batteryFrame(4), batteryFrame(5)
+};
+
+static constexpr MatrixFrame SCREEN_FRAMES[GlyphAtlas::SCREEN_COUNT] = {
+    MatrixFrame{{0, 0, 0, 0, 0, 0, 0, 0}},
+    glyphFrame(fontGlyph('P')),
+    glyphFrame(fontGlyph('E'))
+};
+
+// Fails the build if a table ever stops being a compile-time constant
+static_assert(CHANNEL_FRAMES[15].rows[1] == 0b01001110, "channel 16 top row");
+static_assert(BATTERY_FRAMES[5].rows[1] == 0x81 && BATTERY_FRAMES[5].rows[2] == 0xFF,
+              "battery 100% rows");
+
+const MatrixFrame& GlyphAtlas::channel(uint8_t number) {
+    if (number < MIN_CHANNEL) number = MIN_CHANNEL;
+    if (number > MAX_CHANNEL) number = MAX_CHANNEL;
+    return CHANNEL_FRAMES[number - MIN_CHANNEL];
+}
+
+const MatrixFrame& GlyphAtlas::battery(uint8_t level) {
+    if (level >= BATTERY_LEVELS) level = BATTERY_LEVELS - 1;
+    return BATTERY_FRAMES[level];
+}
+
+const MatrixFrame& GlyphAtlas::screen(uint8_t id) {
+    return SCREEN_FRAMES[id < SCREEN_COUNT ? id : (uint8_t)SCREEN_BLANK];
+}
+
+uint8_t GlyphAtlas::glyphRow(char c, uint8_t row) {
+    return row < GLYPH_HEIGHT ? glyphBits(fontGlyph(c), row) : 0;
+}
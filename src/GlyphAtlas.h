@@ -0,0 +1,47 @@
+/*
+ * Glyph Atlas Module
+ * Compile-time 8x8 matrix screens built from a 3x5 font
+ *
+ * Every screen the matrix shows is computed by the compiler from a compact
+ * 3x5 font and kept in flash: channels 1-16, the six battery levels and
+ * the status letters. Showing one is a table lookup, nothing is composed
+ * at runtime. Rows are MSB-left like the hand-drawn patterns they replace.
+ *
+ * Channels 1-9 read "C" and the digit, 10-16 the two digits. The same
+ * font covers space, digits, A-Z and a little punctuation for text.
+ */
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <Arduino.h>
+
+struct MatrixFrame {
+    uint8_t rows[8];
+};
+
+class GlyphAtlas {
+public:
+    static const uint8_t MIN_CHANNEL = 1;
+    static const uint8_t MAX_CHANNEL = 16;
+    static const uint8_t BATTERY_LEVELS = 6;  // 0-5, 20 % each
+    static const uint8_t GLYPH_WIDTH = 3;
+    static const uint8_t GLYPH_HEIGHT = 5;
+    static const uint8_t GLYPH_TOP = 1;  // Glyphs sit on matrix rows 1-5
+
+    enum Screen {
+        SCREEN_BLANK,
+        SCREEN_PAIRING,  // P
+        SCREEN_RESET,    // E
+        SCREEN_COUNT
+    };
+
+    static const MatrixFrame& channel(uint8_t number);  // Clamped to 1-16
+    static const MatrixFrame& battery(uint8_t level);   // Clamped to 0-5
+    static const MatrixFrame& screen(uint8_t id);       // Blank if unknown
+
+    // One 3-bit row of a text glyph, MSB-left; lowercase draws as uppercase
+    static uint8_t glyphRow(char c, uint8_t row);
+};
+
+#endif
@@ -0,0 +1,334 @@
+/*
+ * LED Controller Module Implementation
+ */
+
+#include "LedController.h"
+
+static const ledc_mode_t LED_MODE = LEDC_LOW_SPEED_MODE;
+static const uint32_t REF_TICK_HZ = 1000000;
+static const uint32_t MAX_DIVIDER = 0x3FFFF;  // 10.8 fixed point
+static const uint32_t MAX_GRADIENT = 1023;    // Step count, cycles per step and scale
+
+LedController::LedController() {
+    for (uint8_t i = 0; i < MAX_LEDS; i++) {
+        leds[i].owner = this;
+        leds[i].index = i;
+        leds[i].pin = 0;
+        leds[i].pattern = PATTERN_OFF;
+        leds[i].duty = 0;
+        leds[i].pulseDuty = 0;
+        leds[i].halfPeriodMs = 0;
+        leds[i].rising = false;
+        leds[i].dueUs = 0;
+        leds[i].timer = nullptr;
+    }
+    ledCount = 0;
+    mutex = nullptr;
+    sleepLock = nullptr;
+    sleepLockHeld = false;
+    onDone = nullptr;
+    programCount = 0;
+    callbackCount = 0;
+}
+
+bool LedController::begin(const uint8_t* pins, uint8_t count, DoneFunction done) {
+    if (count > MAX_LEDS) count = MAX_LEDS;
+    onDone = done;
+    mutex = xSemaphoreCreateMutex();
+
+    // Fails without CONFIG_PM_ENABLE, there is no light sleep to hold off then
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "led_pattern", &sleepLock) != ESP_OK) {
+        sleepLock = nullptr;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        Led& led = leds[i];
+        led.pin = pins[i];
+
+        ledc_timer_config_t timerConfig;
+        memset(&timerConfig, 0, sizeof(timerConfig));
+        timerConfig.speed_mode = LED_MODE;
+        timerConfig.duty_resolution = (ledc_timer_bit_t)PWM_BITS;
+        timerConfig.timer_num = (ledc_timer_t)i;
+        timerConfig.freq_hz = PWM_FREQ_HZ;
+        timerConfig.clk_cfg = LEDC_USE_REF_TICK;
+        if (ledc_timer_config(&timerConfig) != ESP_OK) {
+            Serial.printf("LED %d: LEDC timer setup failed\n", i);
+            return false;
+        }
+
+        esp_timer_create_args_t args;
+        memset(&args, 0, sizeof(args));
+        args.callback = timerCallback;
+        args.arg = &led;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "led";
+        if (esp_timer_create(&args, &led.timer) != ESP_OK) {
+            Serial.printf("LED %d: timer creation failed\n", i);
+            return false;
+        }
+
+        configure(led, 0, PWM_BITS, 0, false);
+        ledCount = i + 1;
+    }
+    return true;
+}
+
+uint32_t LedController::levelToDuty(uint8_t level) {
+    // 2^PWM_BITS is 100 %, so 255 leaves the output high
+    return ((uint32_t)level * (1 << PWM_BITS) + 127) / 255;
+}
+
+void LedController::configure(Led& led, uint32_t divider, uint8_t bits, uint32_t duty, bool inverted) {
+    // divider 0 keeps the timer as begin() set it up
+    if (divider != 0) {
+        ledc_timer_set(LED_MODE, (ledc_timer_t)led.index, divider, bits, LEDC_REF_TICK);
+        ledc_timer_rst(LED_MODE, (ledc_timer_t)led.index);
+    }
+
+    ledc_channel_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.gpio_num = led.pin;
+    config.speed_mode = LED_MODE;
+    config.channel = (ledc_channel_t)led.index;
+    config.intr_type = LEDC_INTR_DISABLE;
+    config.timer_sel = (ledc_timer_t)led.index;
+    config.duty = duty;
+    config.hpoint = 0;
+    config.flags.output_invert = inverted ? 1 : 0;
+    ledc_channel_config(&config);
+    programCount++;
+}
+
+void LedController::configurePwm(Led& led, uint32_t freqHz, uint32_t duty) {
+    uint32_t divider = (uint32_t)(((uint64_t)REF_TICK_HZ << 8) / ((uint64_t)freqHz << PWM_BITS));
+    configure(led, divider, PWM_BITS, duty, false);
+}
+
+void LedController::startRamp(Led& led, uint32_t fromDuty, uint32_t toDuty, uint32_t timeMs,
+                              uint32_t freqHz) {
+    ledc_channel_t channel = (ledc_channel_t)led.index;
+    uint32_t delta = (toDuty > fromDuty) ? toDuty - fromDuty : fromDuty - toDuty;
+    if (delta == 0 || timeMs == 0) {
+        ledc_set_duty(LED_MODE, channel, toDuty);
+        ledc_update_duty(LED_MODE, channel);
+        return;
+    }
+
+    // Spread the change over the PWM periods available, in as many steps
+    // as the gradient unit allows
+    uint32_t cycles = timeMs * freqHz / 1000;
+    if (cycles == 0) cycles = 1;
+    uint32_t scale = 1;
+    uint32_t cyclesPerStep = cycles / delta;
+    if (cyclesPerStep == 0) {
+        cyclesPerStep = 1;
+        scale = (delta + cycles - 1) / cycles;
+    }
+    if (cyclesPerStep > MAX_GRADIENT) cyclesPerStep = MAX_GRADIENT;
+    uint32_t steps = delta / scale;
+    if (steps > MAX_GRADIENT) steps = MAX_GRADIENT;
+
+    ledc_set_fade(LED_MODE, channel, fromDuty,
+                  toDuty > fromDuty ? LEDC_DUTY_DIR_INCREASE : LEDC_DUTY_DIR_DECREASE,
+                  steps, cyclesPerStep, scale);
+    ledc_update_duty(LED_MODE, channel);
+}
+
+void LedController::arm(Led& led, uint32_t afterMs, bool periodic) {
+    led.dueUs = esp_timer_get_time() + (int64_t)afterMs * 1000;
+    if (periodic) {
+        esp_timer_start_periodic(led.timer, (uint64_t)afterMs * 1000);
+    } else {
+        esp_timer_start_once(led.timer, (uint64_t)afterMs * 1000);
+    }
+}
+
+void LedController::disarm(Led& led) {
+    if (led.dueUs != 0) {
+        esp_timer_stop(led.timer);
+        led.dueUs = 0;
+    }
+}
+
+void LedController::updateSleepLock() {
+    if (!sleepLock) return;
+
+    // Off and fully on look the same whether LEDC runs or not
+    bool needed = false;
+    for (uint8_t i = 0; i < ledCount; i++) {
+        const Led& led = leds[i];
+        if (led.pattern == PATTERN_OFF) continue;
+        if (led.pattern == PATTERN_STEADY && led.duty == (1u << PWM_BITS)) continue;
+        needed = true;
+    }
+
+    if (needed && !sleepLockHeld) {
+        esp_pm_lock_acquire(sleepLock);
+        sleepLockHeld = true;
+    } else if (!needed && sleepLockHeld) {
+        esp_pm_lock_release(sleepLock);
+        sleepLockHeld = false;
+    }
+}
+
+void LedController::set(uint8_t index, uint8_t level) {
+    if (index >= ledCount) return;
+    Led& led = leds[index];
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    disarm(led);
+    led.duty = levelToDuty(level);
+    led.pattern = level ? PATTERN_STEADY : PATTERN_OFF;
+    configurePwm(led, PWM_FREQ_HZ, led.duty);
+    updateSleepLock();
+    xSemaphoreGive(mutex);
+}
+
+void LedController::blink(uint8_t index, uint16_t periodMs, uint16_t onMs, bool inverted,
+                          uint32_t durationMs) {
+    if (index >= ledCount || periodMs == 0) return;
+    Led& led = leds[index];
+
+    // The timer itself runs at the blink period: the smallest resolution
+    // whose divider fits gives the finest period
+    uint8_t bits = 8;
+    uint64_t scaled = ((uint64_t)REF_TICK_HZ << 8) * periodMs / 1000;
+    while (bits < 20 && (scaled >> bits) > MAX_DIVIDER) {
+        bits++;
+    }
+    uint32_t divider = (uint32_t)(scaled >> bits);
+    if (onMs > periodMs) onMs = periodMs;
+    uint32_t duty = (uint32_t)(((uint64_t)onMs << bits) / periodMs);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    disarm(led);
+    led.pattern = PATTERN_BLINK;
+    led.duty = 0;
+    configure(led, divider, bits, duty, inverted);
+    if (durationMs != 0) {
+        arm(led, durationMs, false);
+    }
+    updateSleepLock();
+    xSemaphoreGive(mutex);
+}
+
+void LedController::pulse(uint8_t index, uint16_t periodMs, uint8_t level) {
+    if (index >= ledCount || periodMs < 2) return;
+    Led& led = leds[index];
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    disarm(led);
+    led.pattern = PATTERN_PULSE;
+    led.pulseDuty = levelToDuty(level);
+    led.halfPeriodMs = periodMs / 2;
+    led.rising = true;
+    led.duty = 0;
+    configurePwm(led, PWM_FREQ_HZ, 0);
+    startRamp(led, 0, led.pulseDuty, led.halfPeriodMs, PWM_FREQ_HZ);
+    arm(led, led.halfPeriodMs, true);
+    updateSleepLock();
+    xSemaphoreGive(mutex);
+}
+
+void LedController::fade(uint8_t index, uint8_t level, uint16_t timeMs) {
+    if (index >= ledCount) return;
+    Led& led = leds[index];
+    uint32_t target = levelToDuty(level);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    disarm(led);
+    // Blink or flash leave no usable start level, start from their end
+    uint32_t from = (led.pattern == PATTERN_STEADY || led.pattern == PATTERN_FADE) ? led.duty : 0;
+    if (led.pattern != PATTERN_STEADY && led.pattern != PATTERN_FADE &&
+        led.pattern != PATTERN_OFF) {
+        configurePwm(led, PWM_FREQ_HZ, 0);
+    }
+    led.pattern = PATTERN_FADE;
+    led.duty = target;
+    startRamp(led, from, target, timeMs, PWM_FREQ_HZ);
+    arm(led, timeMs, false);
+    updateSleepLock();
+    xSemaphoreGive(mutex);
+}
+
+void LedController::flash(uint8_t index, uint16_t durationMs, uint8_t level) {
+    if (index >= ledCount || durationMs == 0) return;
+    Led& led = leds[index];
+    uint32_t duty = levelToDuty(level);
+
+    // One gradient step of the whole duty after durationMs worth of PWM
+    // periods, slowed down so that count fits the gradient unit. Fully on
+    // does not flicker at any PWM frequency.
+    uint32_t freqHz = MAX_GRADIENT * 1000 / durationMs;
+    if (freqHz > PWM_FREQ_HZ) freqHz = PWM_FREQ_HZ;
+    if (freqHz == 0) freqHz = 1;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    disarm(led);
+    led.pattern = PATTERN_FLASH;
+    led.duty = 0;
+    configurePwm(led, freqHz, duty);
+    ledc_set_fade(LED_MODE, (ledc_channel_t)led.index, duty, LEDC_DUTY_DIR_DECREASE, 1,
+                  (uint32_t)durationMs * freqHz / 1000, duty);
+    ledc_update_duty(LED_MODE, (ledc_channel_t)led.index);
+    arm(led, durationMs, false);
+    updateSleepLock();
+    xSemaphoreGive(mutex);
+}
+
+bool LedController::isActive(uint8_t index) {
+    return index < ledCount && leds[index].pattern != PATTERN_OFF;
+}
+
+void LedController::timerCallback(void* arg) {
+    Led* led = static_cast<Led*>(arg);
+    led->owner->onTimer(*led);
+}
+
+void LedController::onTimer(Led& led) {
+    bool ended = false;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    // A pattern replaced while this callback waited has its own due time
+    if (led.dueUs == 0 || esp_timer_get_time() + 1000 < led.dueUs) {
+        xSemaphoreGive(mutex);
+        return;
+    }
+    callbackCount++;
+
+    if (led.pattern == PATTERN_PULSE) {
+        led.rising = !led.rising;
+        led.dueUs += (int64_t)led.halfPeriodMs * 1000;
+        startRamp(led, led.rising ? 0 : led.pulseDuty, led.rising ? led.pulseDuty : 0,
+                  led.halfPeriodMs, PWM_FREQ_HZ);
+    } else {
+        led.dueUs = 0;
+        if (led.pattern == PATTERN_FADE) {
+            // The gradient has stopped at its level
+            led.pattern = led.duty ? PATTERN_STEADY : PATTERN_OFF;
+        } else {
+            // Timed blink or flash over
+            led.pattern = PATTERN_OFF;
+            led.duty = 0;
+            configurePwm(led, PWM_FREQ_HZ, 0);
+            ended = true;
+        }
+        updateSleepLock();
+    }
+    xSemaphoreGive(mutex);
+
+    if (ended && onDone) {
+        onDone(led.index);
+    }
+}
+
+void LedController::printStats() {
+    static const char* const names[] = {"off", "steady", "blink", "pulse", "fade", "flash"};
+    Serial.printf("LEDs: %lu patterns programmed, %lu timer callbacks, sleep lock %s\n",
+                  (unsigned long)programCount, (unsigned long)callbackCount,
+                  sleepLockHeld ? "held" : "free");
+    for (uint8_t i = 0; i < ledCount; i++) {
+        Serial.printf("LED %d (GPIO %d): %s\n", i, leds[i].pin, names[leds[i].pattern]);
+    }
+}
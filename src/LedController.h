@@ -0,0 +1,95 @@
+/*
+ * LED Controller Module
+ * LED patterns run by the LEDC peripheral
+ *
+ * Each LED gets its own LEDC timer and channel in low speed mode, clocked
+ * from REF_TICK so frequency scaling leaves its timing alone. A pattern is
+ * programmed once and then runs in hardware:
+ *  - blink: the timer runs at the blink period and the duty is the on time
+ *  - fade: the duty gradient ramps to the new level
+ *  - flash: on, then a single gradient step turns it off after the duration
+ *  - pulse: ramps up and down, an esp_timer reverses the ramp every half
+ *    period (the only CPU work, outside loop())
+ * Timed patterns end from an esp_timer callback, nothing is polled.
+ *
+ * LEDC stops with its clock in light sleep, so a NO_LIGHT_SLEEP lock is
+ * held while any LED is moving or dimmed. Plain on and off need none.
+ */
+
+#ifndef LED_CONTROLLER_H
+#define LED_CONTROLLER_H
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+
+class LedController {
+public:
+    static const uint8_t MAX_LEDS = 4;  // One LEDC timer each
+    static const uint32_t PWM_FREQ_HZ = 1000;
+    static const uint8_t PWM_BITS = 9;  // Duty 0..512 at 1 kHz from the 1 MHz REF_TICK
+
+    typedef void (*DoneFunction)(uint8_t led);  // esp_timer task
+
+private:
+    enum Pattern {
+        PATTERN_OFF,
+        PATTERN_STEADY,
+        PATTERN_BLINK,
+        PATTERN_PULSE,
+        PATTERN_FADE,
+        PATTERN_FLASH
+    };
+
+    struct Led {
+        LedController* owner;  // esp_timer argument
+        uint8_t index;
+        uint8_t pin;
+        Pattern pattern;
+        uint32_t duty;        // Duty once the current ramp is done
+        uint32_t pulseDuty;   // Pulse peak
+        uint32_t halfPeriodMs;
+        bool rising;
+        int64_t dueUs;        // Expected timer expiry, 0 when not armed
+        esp_timer_handle_t timer;
+    };
+
+    Led leds[MAX_LEDS];
+    uint8_t ledCount;
+    SemaphoreHandle_t mutex;  // loop() and the esp_timer task
+    esp_pm_lock_handle_t sleepLock;
+    bool sleepLockHeld;
+    DoneFunction onDone;
+
+    // Statistics
+    uint32_t programCount;   // Patterns written to the peripheral
+    uint32_t callbackCount;  // esp_timer wake-ups (pulse reversals, pattern ends)
+
+    static uint32_t levelToDuty(uint8_t level);
+    void configure(Led& led, uint32_t divider, uint8_t bits, uint32_t duty, bool inverted);
+    void configurePwm(Led& led, uint32_t freqHz, uint32_t duty);
+    void startRamp(Led& led, uint32_t fromDuty, uint32_t toDuty, uint32_t timeMs, uint32_t freqHz);
+    void arm(Led& led, uint32_t afterMs, bool periodic);
+    void disarm(Led& led);
+    void updateSleepLock();
+    static void timerCallback(void* arg);
+    void onTimer(Led& led);
+
+public:
+    LedController();
+    bool begin(const uint8_t* pins, uint8_t count, DoneFunction done = nullptr);
+
+    // Each call replaces the LED's current pattern
+    void set(uint8_t led, uint8_t level);  // 0 = off, 255 = fully on
+    void blink(uint8_t led, uint16_t periodMs, uint16_t onMs, bool inverted = false,
+               uint32_t durationMs = 0);  // inverted: on for the rest of the period
+    void pulse(uint8_t led, uint16_t periodMs, uint8_t level = 255);
+    void fade(uint8_t led, uint8_t level, uint16_t timeMs);
+    void flash(uint8_t led, uint16_t durationMs, uint8_t level = 255);
+
+    bool isActive(uint8_t led);
+    void printStats();
+};
+
+#endif
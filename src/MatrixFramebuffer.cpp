@@ -0,0 +1,134 @@
+/*
+ * Matrix Framebuffer Module Implementation
+ */
+
+#include "MatrixFramebuffer.h"
+#include <esp_timer.h>
+
+MatrixFramebuffer::MatrixFramebuffer() {
+    device = nullptr;
+    moduleCount = 1;
+    memset(shadow, 0, sizeof(shadow));
+    memset(onChip, 0, sizeof(onChip));
+    memset(dirtyModules, 0, sizeof(dirtyModules));
+    chipKnown = false;
+    frameCount = 0;
+    unchangedFrameCount = 0;
+    rowWriteCount = 0;
+    rowSkipCount = 0;
+    updateCount = 0;
+    spiTimeUs = 0;
+}
+
+void MatrixFramebuffer::begin(MD_MAX72XX* display, uint8_t modules) {
+    device = display;
+    moduleCount = constrain(modules, 1, MAX_MODULES);
+    memset(shadow, 0, sizeof(shadow));
+    memset(onChip, 0, sizeof(onChip));
+    memset(dirtyModules, 0, sizeof(dirtyModules));
+    chipKnown = true;
+
+    // Rows collect in the library buffer until update() sends them together
+    device->control(MD_MAX72XX::UPDATE, MD_MAX72XX::OFF);
+}
+
+void MatrixFramebuffer::invalidate() {
+    chipKnown = false;
+    memset(dirtyModules, (1 << moduleCount) - 1, sizeof(dirtyModules));
+}
+
+uint8_t MatrixFramebuffer::getModuleCount() {
+    return moduleCount;
+}
+
+uint8_t MatrixFramebuffer::getFrameSize() {
+    return moduleCount * ROWS;
+}
+
+void MatrixFramebuffer::setRow(uint8_t module, uint8_t row, uint8_t value) {
+    if (module >= moduleCount || row >= ROWS) return;
+    uint8_t index = module * ROWS + row;
+    shadow[index] = value;
+
+    // Compared now, so flush() and isDirty() only look at the masks
+    if (!chipKnown || value != onChip[index]) {
+        dirtyModules[row] |= (1 << module);
+    } else {
+        dirtyModules[row] &= ~(1 << module);
+        rowSkipCount++;
+    }
+}
+
+void MatrixFramebuffer::setFrame(const uint8_t* frame) {
+    frameCount++;
+    for (uint8_t module = 0; module < moduleCount; module++) {
+        for (uint8_t row = 0; row < ROWS; row++) {
+            setRow(module, row, frame[module * ROWS + row]);
+        }
+    }
+    if (!isDirty()) {
+        unchangedFrameCount++;
+    }
+}
+
+void MatrixFramebuffer::clear() {
+    static const uint8_t blank[MAX_MODULES * ROWS] = {0};
+    show(blank);
+}
+
+uint8_t MatrixFramebuffer::getRow(uint8_t module, uint8_t row) {
+    return (module < moduleCount && row < ROWS) ? shadow[module * ROWS + row] : 0;
+}
+
+void MatrixFramebuffer::show(const uint8_t* frame) {
+    setFrame(frame);
+    flush();
+}
+
+bool MatrixFramebuffer::isDirty() {
+    for (uint8_t row = 0; row < ROWS; row++) {
+        if (dirtyModules[row]) return true;
+    }
+    return false;
+}
+
+uint8_t MatrixFramebuffer::flush() {
+    if (!device || !isDirty()) return 0;
+
+    int64_t start = esp_timer_get_time();
+    uint8_t sent = 0;
+    for (uint8_t row = 0; row < ROWS; row++) {
+        for (uint8_t module = 0; module < moduleCount; module++) {
+            if (!(dirtyModules[row] & (1 << module))) continue;
+            uint8_t index = module * ROWS + row;
+            device->setRow(module, row, shadow[index]);
+            onChip[index] = shadow[index];
+            sent++;
+        }
+        dirtyModules[row] = 0;
+    }
+    device->update();
+    spiTimeUs += esp_timer_get_time() - start;
+    rowWriteCount += sent;
+    updateCount++;
+
+    // Rows not sent since invalidate() are still unknown
+    if (sent == moduleCount * ROWS) {
+        chipKnown = true;
+    }
+    return sent;
+}
+
+uint32_t MatrixFramebuffer::getRowWriteCount() {
+    return rowWriteCount;
+}
+
+void MatrixFramebuffer::printStats() {
+    Serial.printf("Matrix: %d modules, %lu frames (%lu unchanged), %lu rows sent in %lu updates, "
+                  "%lu rows skipped\n",
+                  moduleCount, (unsigned long)frameCount, (unsigned long)unchangedFrameCount,
+                  (unsigned long)rowWriteCount, (unsigned long)updateCount,
+                  (unsigned long)rowSkipCount);
+    Serial.printf("Matrix: %lu us in SPI, %lu rows/s of SPI time\n", (unsigned long)spiTimeUs,
+                  (unsigned long)(spiTimeUs ? rowWriteCount * 1000000ULL / spiTimeUs : 0));
+}
@@ -0,0 +1,68 @@
+/*
+ * Matrix Framebuffer Module
+ * Shadow framebuffer for a chain of MAX7219 8x8 modules
+ *
+ * Frames are drawn into a shadow copy of the row registers of every
+ * module. flush() compares it with what the chips already show and hands
+ * only the rows that differ to MD_MAX72XX, then sends them in one update:
+ * the library shifts one frame per digit register through the whole
+ * chain, with no-op commands for the modules whose row did not change.
+ * An unchanged frame sends nothing, so redrawing the same pattern from
+ * loop() costs a compare instead of SPI transfers.
+ *
+ * Frames are module-major, ROWS bytes per module. Module 0 is the
+ * rightmost, as MD_MAX72XX numbers them. The counters give rows written,
+ * batched updates, time spent in SPI and rows per second of SPI time,
+ * printed with the serial statistics.
+ */
+
+#ifndef MATRIX_FRAMEBUFFER_H
+#define MATRIX_FRAMEBUFFER_H
+
+#include <Arduino.h>
+#include <MD_MAX72xx.h>
+
+class MatrixFramebuffer {
+public:
+    static const uint8_t ROWS = 8;
+    static const uint8_t MAX_MODULES = 4;  // One RenderTask frame
+
+private:
+    MD_MAX72XX* device;
+    uint8_t moduleCount;
+    uint8_t shadow[MAX_MODULES * ROWS];  // Frame being drawn
+    uint8_t onChip[MAX_MODULES * ROWS];  // Rows as last sent
+    uint8_t dirtyModules[ROWS];          // Per row, bit per module that differs
+    bool chipKnown;                      // False until a full frame went out
+
+    // Statistics
+    uint32_t frameCount;
+    uint32_t unchangedFrameCount;
+    uint32_t rowWriteCount;  // Module rows sent
+    uint32_t rowSkipCount;
+    uint32_t updateCount;    // Batched chain updates
+    uint64_t spiTimeUs;
+
+public:
+    MatrixFramebuffer();
+    void begin(MD_MAX72XX* display, uint8_t modules);  // Display initialized and cleared
+    void invalidate();                                  // Chip content unknown, resend everything
+
+    uint8_t getModuleCount();
+    uint8_t getFrameSize();  // Bytes in a frame for setFrame()
+
+    void setRow(uint8_t module, uint8_t row, uint8_t value);
+    void setFrame(const uint8_t* frame);
+    void clear();
+    uint8_t getRow(uint8_t module, uint8_t row);
+
+    // Draw and flush in one go
+    void show(const uint8_t* frame);
+    bool isDirty();
+    uint8_t flush();  // Returns the number of module rows sent
+
+    uint32_t getRowWriteCount();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Matrix Scroller Module Implementation
+ */
+
+#include "MatrixScroller.h"
+
+static_assert(MatrixFramebuffer::MAX_MODULES * MatrixFramebuffer::ROWS <= RenderTask::MAX_FRAME_SIZE,
+              "a full chain must fit in one render frame");
+
+MatrixScroller::MatrixScroller() {
+    renderer = nullptr;
+    moduleCount = 1;
+    stepUs = 0;
+    holdSteps = 0;
+    timer = nullptr;
+    mutex = nullptr;
+    text[0] = '\0';
+    textLength = 0;
+    offset = 0;
+    endOffset = 0;
+    stepsLeft = 0;
+    active.store(false);
+    finished.store(false);
+    textCount = 0;
+    stepCount = 0;
+}
+
+bool MatrixScroller::begin(RenderTask* target, uint8_t modules, uint32_t stepMs, uint32_t holdMs) {
+    renderer = target;
+    moduleCount = constrain(modules, 1, MatrixFramebuffer::MAX_MODULES);
+    stepUs = (uint64_t)stepMs * 1000;
+    holdSteps = stepMs ? holdMs / stepMs : 0;
+
+    mutex = xSemaphoreCreateMutex();
+    esp_timer_create_args_t args;
+    memset(&args, 0, sizeof(args));
+    args.callback = timerCallback;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "scroll";
+    if (!mutex || esp_timer_create(&args, &timer) != ESP_OK) {
+        Serial.println("Scroller: timer creation failed");
+        timer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+uint16_t MatrixScroller::getPanelWidth() {
+    return moduleCount * 8;
+}
+
+uint16_t MatrixScroller::getTextWidth() {
+    return textLength ? textLength * CHAR_PITCH - 1 : 0;
+}
+
+void MatrixScroller::show(const char* message) {
+    if (!timer) return;
+
+    esp_timer_stop(timer);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    strncpy(text, message, MAX_TEXT);
+    text[MAX_TEXT] = '\0';
+    textLength = strlen(text);
+
+    int16_t panel = getPanelWidth();
+    int16_t width = getTextWidth();
+    if (width <= panel) {
+        // Fits: centered, held for holdMs
+        offset = (panel - width) / 2;
+        endOffset = offset;
+        stepsLeft = holdSteps;
+    } else {
+        // In from the right edge, out past the left one
+        offset = panel;
+        endOffset = -width;
+        stepsLeft = 0;
+    }
+    textCount++;
+    active.store(true);
+    finished.store(false);
+    xSemaphoreGive(mutex);
+
+    step();
+    esp_timer_start_periodic(timer, stepUs);
+}
+
+void MatrixScroller::stop() {
+    if (!timer) return;
+
+    esp_timer_stop(timer);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    active.store(false);
+    xSemaphoreGive(mutex);
+}
+
+bool MatrixScroller::isActive() {
+    return active.load();
+}
+
+bool MatrixScroller::takeFinished() {
+    return finished.exchange(false);
+}
+
+void MatrixScroller::timerCallback(void* arg) {
+    static_cast<MatrixScroller*>(arg)->step();
+}
+
+void MatrixScroller::step() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (!active.load()) {
+        xSemaphoreGive(mutex);
+        return;
+    }
+
+    bool done;
+    if (offset == endOffset) {
+        // Held text counts down, scrolled text has left the panel
+        done = stepsLeft == 0;
+        if (!done) stepsLeft--;
+    } else {
+        offset--;
+        done = false;
+    }
+
+    if (done) {
+        esp_timer_stop(timer);
+        active.store(false);
+        finished.store(true);
+    } else {
+        // Published under the mutex, so nothing lands after stop() returns
+        uint8_t frame[MatrixFramebuffer::MAX_MODULES * MatrixFramebuffer::ROWS];
+        compose(frame, offset);
+        renderer->publish(frame);
+        stepCount++;
+    }
+    xSemaphoreGive(mutex);
+}
+
+void MatrixScroller::compose(uint8_t* frame, int16_t start) {
+    // Each row as one bit string, bit (panel - 1 - x) is panel column x
+    int16_t panel = getPanelWidth();
+    for (uint8_t row = 0; row < MatrixFramebuffer::ROWS; row++) {
+        uint32_t bits = 0;
+        uint8_t glyphRow = row - GlyphAtlas::GLYPH_TOP;
+        if (row >= GlyphAtlas::GLYPH_TOP && glyphRow < GlyphAtlas::GLYPH_HEIGHT) {
+            for (uint8_t i = 0; i < textLength; i++) {
+                int16_t x = start + i * CHAR_PITCH;
+                if (x <= -GlyphAtlas::GLYPH_WIDTH || x >= panel) continue;
+
+                uint32_t glyph = GlyphAtlas::glyphRow(text[i], glyphRow);
+                int16_t shift = panel - GlyphAtlas::GLYPH_WIDTH - x;
+                bits |= shift >= 0 ? glyph << shift : glyph >> -shift;
+            }
+        }
+
+        // Module 0 is the rightmost 8 columns
+        for (uint8_t module = 0; module < moduleCount; module++) {
+            frame[module * MatrixFramebuffer::ROWS + row] = (bits >> (8 * module)) & 0xFF;
+        }
+    }
+}
+
+void MatrixScroller::printStats() {
+    Serial.printf("Scroller: %d columns, %lu texts, %lu steps%s\n", getPanelWidth(),
+                  (unsigned long)textCount, (unsigned long)stepCount,
+                  active.load() ? " (showing)" : "");
+}
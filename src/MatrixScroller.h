@@ -0,0 +1,72 @@
+/*
+ * Matrix Scroller Module
+ * Timer-driven text on the MAX7219 panel
+ *
+ * show() puts a short text on the panel. When it is wider than the chain
+ * it scrolls in from the right and out to the left, one column per step;
+ * otherwise it is centered and held. The steps run from an esp_timer, so
+ * the scroll speed does not depend on how long loop() sleeps, and each
+ * step is one frame published to the render task.
+ *
+ * Text uses the GlyphAtlas 3x5 font with one blank column between
+ * characters. While isActive() the scroller owns the panel; takeFinished()
+ * tells loop() once when a text is done so it can put its screen back.
+ */
+
+#ifndef MATRIX_SCROLLER_H
+#define MATRIX_SCROLLER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+#include "GlyphAtlas.h"
+#include "MatrixFramebuffer.h"
+#include <RenderTask.h>
+
+class MatrixScroller {
+public:
+    static const uint8_t MAX_TEXT = 24;
+    static const uint8_t CHAR_PITCH = GlyphAtlas::GLYPH_WIDTH + 1;
+
+private:
+    RenderTask* renderer;
+    uint8_t moduleCount;
+    uint64_t stepUs;
+    uint16_t holdSteps;
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t mutex;  // Keeps stop() from racing a step in flight
+
+    // Under mutex
+    char text[MAX_TEXT + 1];
+    uint8_t textLength;
+    int16_t offset;     // Panel column where the text starts, negative when scrolled out left
+    int16_t endOffset;
+    uint16_t stepsLeft;  // Hold steps for text that fits
+
+    std::atomic<bool> active;
+    std::atomic<bool> finished;
+
+    // Statistics
+    uint32_t textCount;
+    uint32_t stepCount;
+
+    static void timerCallback(void* arg);
+    void step();
+    void compose(uint8_t* frame, int16_t start);
+    uint16_t getTextWidth();
+
+public:
+    MatrixScroller();
+    bool begin(RenderTask* target, uint8_t modules, uint32_t stepMs, uint32_t holdMs);
+
+    // loop() side
+    void show(const char* message);
+    void stop();
+    bool isActive();
+    bool takeFinished();  // True once after a text ran to its end
+
+    uint16_t getPanelWidth();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * MIDI Transmitter Module Implementation
+ */
+
+#include "MidiTransmitter.h"
+#include <esp_timer.h>
+
+MidiTransmitter::MidiTransmitter() {
+    head.store(0);
+    tail.store(0);
+    flushedHead = 0;
+    pendingHead = 0;
+    pendingCount = 0;
+    pendingDiscard.store(false);
+    task = nullptr;
+    powerLock = nullptr;
+    powerLockHeld = false;
+    highWater.store(0);
+    droppedCount.store(0);
+    heldCount = 0;
+}
+
+bool MidiTransmitter::begin(BLECharacteristic* characteristic, BaseType_t core, UBaseType_t priority) {
+    flowControl.begin(characteristic);
+
+    BaseType_t result = xTaskCreatePinnedToCore(taskEntry, "midi_tx", TASK_STACK_SIZE,
+                                                this, priority, &task, core);
+    if (result != pdPASS) {
+        Serial.println("MIDI TX task creation failed");
+        task = nullptr;
+        return false;
+    }
+
+    Serial.printf("MIDI TX task started on core %d, priority %d\n", (int)core, (int)priority);
+    return true;
+}
+
+bool MidiTransmitter::push(const uint8_t* data, uint8_t length, uint16_t timestamp, int64_t sourceUs,
+                           bool continuous) {
+    if (length > sizeof(queue[0].data)) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    MidiTxEvent event;
+    memcpy(event.data, data, length);
+    event.length = length;
+    event.continuous = continuous;
+    event.timestamp = timestamp;
+    event.sourceUs = sourceUs;
+    event.enqueueUs = esp_timer_get_time();
+
+    // Held events go first so switch events keep their order
+    movePending();
+    if (pendingCount == 0 && enqueue(event)) {
+        return true;
+    }
+
+    // A newer continuous value follows anyway, a switch event is held
+    if (continuous || pendingCount == PENDING_SIZE) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pending[(pendingHead + pendingCount) % PENDING_SIZE] = event;
+    pendingCount++;
+    heldCount++;
+    return true;
+}
+
+bool MidiTransmitter::enqueue(const MidiTxEvent& event) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= QUEUE_SIZE) return false;
+
+    queue[h & (QUEUE_SIZE - 1)] = event;
+    head.store(h + 1, std::memory_order_release);
+
+    uint32_t depth = h + 1 - t;
+    if (depth > highWater.load(std::memory_order_relaxed)) {
+        highWater.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void MidiTransmitter::movePending() {
+    // Meant for the central that just left
+    if (pendingDiscard.exchange(false)) {
+        pendingHead = 0;
+        pendingCount = 0;
+    }
+
+    while (pendingCount > 0 && enqueue(pending[pendingHead])) {
+        pendingHead = (pendingHead + 1) % PENDING_SIZE;
+        pendingCount--;
+    }
+}
+
+void MidiTransmitter::flush() {
+    movePending();
+
+    // One wake-up per loop pass, so events of the same pass share a packet
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h == flushedHead) return;
+
+    flushedHead = h;
+    wake();
+}
+
+void MidiTransmitter::wake() {
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+void MidiTransmitter::taskEntry(void* arg) {
+    static_cast<MidiTransmitter*>(arg)->run();
+}
+
+void MidiTransmitter::setPowerLock(esp_pm_lock_handle_t lock) {
+    powerLock = lock;
+}
+
+void MidiTransmitter::run() {
+    for (;;) {
+        // Poll while something is held back, the confirm timeout needs it
+        ulTaskNotifyTake(pdTRUE, flowControl.isIdle() ? portMAX_DELAY : pdMS_TO_TICKS(FLOW_POLL_MS));
+
+        if (powerLock && !powerLockHeld) {
+            esp_pm_lock_acquire(powerLock);
+            powerLockHeld = true;
+        }
+
+        int64_t now = esp_timer_get_time();
+        flowControl.update(now);
+
+        // When the backlog is full a switch event stays in the ring
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        while (t != head.load(std::memory_order_acquire)) {
+            if (!flowControl.push(queue[t & (QUEUE_SIZE - 1)])) break;
+            tail.store(++t, std::memory_order_release);
+        }
+
+        flowControl.sendBacklog(now);
+
+        // Sleep is fine again once nothing waits for a confirm
+        if (powerLockHeld && flowControl.isIdle() && t == head.load(std::memory_order_acquire)) {
+            esp_pm_lock_release(powerLock);
+            powerLockHeld = false;
+        }
+    }
+}
+
+void MidiTransmitter::setMtu(uint16_t mtu) {
+    flowControl.setMtu(mtu);
+}
+
+void MidiTransmitter::onCongestion(bool congested) {
+    flowControl.onCongestion(congested);
+    if (!congested) {
+        wake();
+    }
+}
+
+void MidiTransmitter::onNotifyResult(esp_gatt_status_t status) {
+    flowControl.onNotifyResult(status);
+    wake();
+}
+
+void MidiTransmitter::onNotifyStatus(BLECharacteristicCallbacks::Status status) {
+    // Called from inside notify(), the TX task picks it up right after
+    flowControl.onNotifyStatus(status);
+}
+
+void MidiTransmitter::onDisconnect() {
+    flowControl.onDisconnect();
+    pendingDiscard.store(true);
+    wake();
+}
+
+uint32_t MidiTransmitter::getQueueDepth() {
+    return head.load() - tail.load();
+}
+
+uint32_t MidiTransmitter::getHighWater() {
+    return highWater.load();
+}
+
+uint32_t MidiTransmitter::getDroppedCount() {
+    return droppedCount.load();
+}
+
+void MidiTransmitter::printStats() {
+    Serial.printf("MIDI TX queue: depth %lu, high-water %lu/%lu, held %lu (now %u), dropped %lu\n",
+                  (unsigned long)getQueueDepth(), (unsigned long)highWater.load(),
+                  (unsigned long)QUEUE_SIZE, (unsigned long)heldCount, (unsigned)pendingCount,
+                  (unsigned long)droppedCount.load());
+    flowControl.printStats();
+}
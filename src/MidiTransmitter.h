@@ -0,0 +1,90 @@
+/*
+ * MIDI Transmitter Module
+ * BLE-MIDI transmit task fed by a lock-free queue
+ *
+ * Input handling pushes compact MIDI events into a single-producer/
+ * single-consumer ring and calls flush() once per loop pass. A FreeRTOS
+ * task pinned next to the Bluedroid host drains the ring into the flow
+ * control backlog, which coalesces it into BLE-MIDI packets and notifies
+ * them when the link can take them. A slow notify no longer holds up the
+ * button scan, and a blocking display update no longer holds up a notify.
+ *
+ * With a power management lock set, the task holds it from the wake-up
+ * until everything is confirmed, so a packet never waits on light sleep.
+ *
+ * A switch event that finds the ring full is held on the producer side and
+ * moved into the ring by the next push() or flush(), in order. Ring, held
+ * events and the flow control backlog together keep 128 switch events
+ * through a stalled link, over a second of all six footswitches at the
+ * debounce limit. Only past that, or for a continuous value, is an event
+ * dropped.
+ */
+
+#ifndef MIDI_TRANSMITTER_H
+#define MIDI_TRANSMITTER_H
+
+#include <Arduino.h>
+#include <BLECharacteristic.h>
+#include <esp_pm.h>
+#include <atomic>
+#include <MidiFlowControl.h>
+
+class MidiTransmitter {
+public:
+    static const uint32_t QUEUE_SIZE = 32;  // Power of two
+    static const uint8_t PENDING_SIZE = 32;
+    static const uint32_t TASK_STACK_SIZE = 4096;
+    static const uint32_t FLOW_POLL_MS = 5;  // Wake-up while packets are held
+
+private:
+    MidiTxEvent queue[QUEUE_SIZE];
+    std::atomic<uint32_t> head;  // Written by the producer only
+    std::atomic<uint32_t> tail;  // Written by the TX task only
+    uint32_t flushedHead;        // Producer side, head at the last flush()
+
+    // Producer side, switch events waiting for room in the ring
+    MidiTxEvent pending[PENDING_SIZE];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+    std::atomic<bool> pendingDiscard;  // Set on disconnect
+
+    TaskHandle_t task;
+    esp_pm_lock_handle_t powerLock;
+    bool powerLockHeld;  // TX task only
+    MidiFlowControl flowControl;  // TX task only, BLE events are atomics
+
+    // Statistics
+    std::atomic<uint32_t> highWater;
+    std::atomic<uint32_t> droppedCount;
+    uint32_t heldCount;  // Producer side
+
+    bool enqueue(const MidiTxEvent& event);
+    void movePending();
+    static void taskEntry(void* arg);
+    void run();
+    void wake();
+
+public:
+    MidiTransmitter();
+    bool begin(BLECharacteristic* characteristic, BaseType_t core, UBaseType_t priority);
+    void setPowerLock(esp_pm_lock_handle_t lock);  // Before begin()
+
+    // Producer side (loop task)
+    bool push(const uint8_t* data, uint8_t length, uint16_t timestamp, int64_t sourceUs,
+              bool continuous = false);
+    void flush();
+
+    // BLE task
+    void setMtu(uint16_t mtu);
+    void onCongestion(bool congested);
+    void onNotifyResult(esp_gatt_status_t status);
+    void onNotifyStatus(BLECharacteristicCallbacks::Status status);
+    void onDisconnect();
+
+    uint32_t getQueueDepth();
+    uint32_t getHighWater();
+    uint32_t getDroppedCount();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Wake Manager Module Implementation
+ */
+
+#include "WakeManager.h"
+#include <driver/rtc_io.h>
+#include <esp_timer.h>
+#include <esp32/ulp.h>
+#include <soc/rtc_io_reg.h>
+
+static const uint32_t STATE_MAGIC = 0x57414B45;  // "WAKE"
+
+// Survives deep sleep, not a power cycle
+RTC_DATA_ATTR static uint32_t rtcStateMagic = 0;
+RTC_DATA_ATTR static uint32_t rtcStateSize = 0;
+RTC_DATA_ATTR static uint8_t rtcState[WakeManager::STATE_SIZE];
+RTC_DATA_ATTR static uint8_t rtcLowRtcIo = 0;
+
+WakeManager::WakeManager() {
+    pinCount = 0;
+    cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    wakeButton = -1;
+    wakeTimeUs = 0;
+    replayPending = false;
+}
+
+void WakeManager::begin(const uint8_t* buttonPins, uint8_t count) {
+    if (count > MAX_PINS) count = MAX_PINS;
+    pinCount = count;
+    memcpy(pins, buttonPins, count);
+    cause = esp_sleep_get_wakeup_cause();
+    wakeTimeUs = esp_timer_get_time();  // Earliest point the app can stamp the press
+    
+    // The pins were left to the RTC domain for the ULP, give them back
+    for (uint8_t i = 0; i < pinCount; i++) {
+        if (rtc_gpio_is_valid_gpio((gpio_num_t)pins[i])) {
+            rtc_gpio_deinit((gpio_num_t)pins[i]);
+        }
+    }
+    
+    if (cause == ESP_SLEEP_WAKEUP_ULP) {
+        // The ULP stored one bit per switch that read low, relative to the lowest RTC IO
+        uint32_t low = RTC_SLOW_MEM[ULP_DATA_WORD] & 0xFFFF;
+        for (uint8_t i = 0; i < pinCount && wakeButton < 0; i++) {
+            int rtcIo = rtc_io_number_get((gpio_num_t)pins[i]);
+            if (rtcIo >= 0 && (low >> (rtcIo - rtcLowRtcIo)) & 0x1) {
+                wakeButton = i;
+            }
+        }
+    } else if (cause == ESP_SLEEP_WAKEUP_EXT0) {
+        wakeButton = 0;
+    }
+    
+    replayPending = wakeButton >= 0;
+    if (isWakeFromSleep()) {
+        Serial.printf("Wake: from deep sleep, button %d\n", wakeButton + 1);
+    }
+}
+
+bool WakeManager::isWakeFromSleep() {
+    return cause == ESP_SLEEP_WAKEUP_ULP || cause == ESP_SLEEP_WAKEUP_EXT0;
+}
+
+int8_t WakeManager::getWakeButton() {
+    return wakeButton;
+}
+
+int64_t WakeManager::getWakeTimeUs() {
+    return wakeTimeUs;
+}
+
+bool WakeManager::loadState(void* state, size_t size) {
+    if (!isWakeFromSleep() || rtcStateMagic != STATE_MAGIC || rtcStateSize != size) {
+        return false;
+    }
+    memcpy(state, rtcState, size);
+    return true;
+}
+
+void WakeManager::saveState(const void* state, size_t size) {
+    if (size > STATE_SIZE) return;
+    memcpy(rtcState, state, size);
+    rtcStateSize = size;
+    rtcStateMagic = STATE_MAGIC;
+}
+
+int8_t WakeManager::takeWakePress(bool linkReady) {
+    if (!replayPending) return -1;
+    
+    if (millis() > REPLAY_TIMEOUT_MS) {
+        // Too late to mean anything to the player
+        replayPending = false;
+        Serial.println("Wake: no host in time, wake press dropped");
+        return -1;
+    }
+    if (!linkReady) return -1;
+    
+    replayPending = false;
+    return wakeButton;
+}
+
+bool WakeManager::armUlp() {
+    // One register read covers every switch if their RTC IOs span 16 bits or less
+    int lowIo = 31;
+    int highIo = 0;
+    for (uint8_t i = 0; i < pinCount; i++) {
+        int rtcIo = rtc_io_number_get((gpio_num_t)pins[i]);
+        if (rtcIo < 0) return false;
+        if (rtcIo < lowIo) lowIo = rtcIo;
+        if (rtcIo > highIo) highIo = rtcIo;
+    }
+    if (pinCount == 0 || highIo - lowIo > 15) return false;
+    
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < pinCount; i++) {
+        gpio_num_t pin = (gpio_num_t)pins[i];
+        mask |= 1 << (rtc_io_number_get(pin) - lowIo);
+        rtc_gpio_init(pin);
+        rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+        rtc_gpio_pulldown_dis(pin);
+        rtc_gpio_pullup_en(pin);
+    }
+    rtcLowRtcIo = lowIo;
+    RTC_SLOW_MEM[ULP_DATA_WORD] = 0;
+    
+    const ulp_insn_t program[] = {
+        I_RD_REG(RTC_GPIO_IN_REG, RTC_GPIO_IN_NEXT_S + lowIo, RTC_GPIO_IN_NEXT_S + highIo),
+        I_ANDI(R0, R0, mask),
+        I_MOVI(R1, mask),
+        I_SUBR(R0, R1, R0),  // Bits of the switches reading low
+        M_BXZ(1),
+        I_MOVI(R2, ULP_DATA_WORD),
+        I_ST(R0, R2, 0),
+        I_WAKE(),
+        I_END(),             // Stop the poll timer
+        M_LABEL(1),
+        I_HALT()
+    };
+    size_t size = sizeof(program) / sizeof(ulp_insn_t);
+    if (ulp_process_macros_and_load(0, program, &size) != ESP_OK) return false;
+    
+    // Pull-ups and the ULP need the RTC peripherals powered
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    ulp_set_wakeup_period(0, POLL_PERIOD_US);
+    esp_sleep_enable_ulp_wakeup();
+    return ulp_run(0) == ESP_OK;
+}
+
+void WakeManager::armFallback() {
+    // ext0 can watch a single active-low pin
+    gpio_num_t pin = (gpio_num_t)pins[0];
+    rtc_gpio_pulldown_dis(pin);
+    rtc_gpio_pullup_en(pin);
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    esp_sleep_enable_ext0_wakeup(pin, 0);
+}
+
+void WakeManager::enterDeepSleep() {
+    if (!armUlp()) {
+        Serial.println("Wake: ULP unavailable, only button 1 wakes the pedal");
+        armFallback();
+    }
+    Serial.flush();
+    esp_deep_sleep_start();
+}
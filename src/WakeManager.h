@@ -0,0 +1,61 @@
+/*
+ * Wake Manager Module
+ * Deep sleep wake-up on any footswitch and replay of the waking press
+ *
+ * ext1 wake-up can only wake on ANY_HIGH or ALL_LOW. Neither fits active-low
+ * switches with pull-ups: ANY_HIGH is always true, ALL_LOW needs every
+ * switch down at once. The ULP coprocessor polls the switches instead, every
+ * POLL_PERIOD_US, and wakes the chip as soon as one reads low. It leaves the
+ * levels it saw in RTC slow memory, so the waking switch is known even if it
+ * was released during boot.
+ *
+ * A small block of state (configuration, display) is kept in RTC memory
+ * across deep sleep so a wake can skip the NVS reads and the boot
+ * animation. The waking press is held until the host is connected and
+ * listening, then handed back once, or dropped after REPLAY_TIMEOUT_MS.
+ * The wake is timestamped in begin() (esp_timer, from app start) so the
+ * replayed press keeps the time it was made, not the time it was sent.
+ */
+
+#ifndef WAKE_MANAGER_H
+#define WAKE_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+
+class WakeManager {
+public:
+    static const uint8_t MAX_PINS = 8;
+    static const uint32_t POLL_PERIOD_US = 20000;
+    static const unsigned long REPLAY_TIMEOUT_MS = 10000;
+    static const uint32_t ULP_DATA_WORD = 64;  // Inside the ULP reserved area, after the program
+    static const size_t STATE_SIZE = 32;
+
+private:
+    uint8_t pins[MAX_PINS];
+    uint8_t pinCount;
+    esp_sleep_wakeup_cause_t cause;
+    int8_t wakeButton;
+    int64_t wakeTimeUs;
+    bool replayPending;
+
+    bool armUlp();
+    void armFallback();
+
+public:
+    WakeManager();
+    void begin(const uint8_t* buttonPins, uint8_t count);
+
+    bool isWakeFromSleep();
+    int8_t getWakeButton();
+    int64_t getWakeTimeUs();
+    bool loadState(void* state, size_t size);
+    void saveState(const void* state, size_t size);
+
+    // Button index once the link is ready, -1 otherwise
+    int8_t takeWakePress(bool linkReady);
+
+    void enterDeepSleep();
+};
+
+#endif
@@ -5,11 +5,29 @@
 #include <BLE2902.h>
 #include <Preferences.h>
 #include <MD_MAX72xx.h>
+#include <esp_timer.h>
+#include <BootProfiler.h>
+#include <ConnectionManager.h>
+#include <EdgeCapture.h>
+#include <MidiPacketBuilder.h>
+#include <MidiParser.h>
+#include <PowerManager.h>
+#include <ReconnectManager.h>
+#include <RenderTask.h>
+#include <Timeline.h>
+#include <TxPowerControl.h>
+#include "GlyphAtlas.h"
+#include "LedController.h"
+#include "MatrixFramebuffer.h"
+#include "MatrixScroller.h"
+#include "MidiTransmitter.h"
+#include "WakeManager.h"
 
 // MAX7219 Matrix Display Pins
 #define MAX7219_DIN 21
 #define MAX7219_CLK 18
 #define MAX7219_CS 19
+#define MAX7219_MODULES 1  // Cascaded 8x8 modules, up to MatrixFramebuffer::MAX_MODULES
 
 // Button Pins
 #define PIN_BUTTON_1 32
@@ -23,12 +41,17 @@
 #define PIN_LED_CHARGING 15  // Green LED for charging indication
 #define PIN_LED_ACTIVITY 4   // Orange LED for button press indication
 
+// LED Controller channels (LEDC timer and channel numbers)
+#define LED_ACTIVITY 0
+#define LED_CHARGING 1
+
 // Analog Pins
 #define PIN_BATTERY_VOLTAGE 35
 // #define PIN_CHARGING_STATUS 34  // Non utilisé (TC4056 4-pins sans CHRG)
 
 // Timing Constants
 #define BUTTON_DEBOUNCE_MS 100
+#define BUTTON_LOCKOUT_MS 30     // Fire-on-press: ignore bounces after an accepted edge
 #define LONG_PRESS_MS 1000
 #define FACTORY_RESET_MS 3000
 #define BATTERY_READ_INTERVAL_MS 10000
@@ -36,54 +59,46 @@
 #define BATTERY_DISPLAY_TIME_MS 3000
 #define ACTIVITY_LED_DURATION_MS 500
 #define BLINK_INTERVAL_MS 500
+#define LOOP_IDLE_WAIT_MS 50  // Loop period while connected with no footswitch held
 
 // MIDI BLE Service UUIDs
 #define MIDI_SERVICE_UUID        "03B80E5A-EDE8-4B33-A751-6CE34EC4C700"
 #define MIDI_CHARACTERISTIC_UUID "7772E5DB-3868-4112-A1A9-F2669D106BF3"
+#define BLE_MIDI_MTU 247  // Local ATT MTU offered to the central
+#define BLE_CONN_INTERVAL_MIN 6    // 7.5 ms (1.25 ms units)
+#define BLE_CONN_INTERVAL_MAX 12   // 15 ms
+#define BLE_SLAVE_LATENCY 0        // Never skip an event, a press must go out on the next one
+#define BLE_SUPERVISION_TIMEOUT 400  // 4 s (10 ms units)
+#define BLE_TX_POWER_MIN ESP_PWR_LVL_N12  // RSSI-driven range while connected
+#define BLE_TX_POWER_MAX ESP_PWR_LVL_P9
+#define CPU_FREQ_MAX_MHZ 240  // Hot paths only, under a PowerLock
+#define CPU_FREQ_MIN_MHZ 80   // Idle baseline, light sleep below it when connected
+#define LIGHT_SLEEP_ENABLED 1
+#define MIDI_TX_TASK_CORE 0       // Same core as the Bluedroid host
+#define MIDI_TX_TASK_PRIORITY 10  // Above loop(), below the BT controller/host tasks
+#define BOOT_TASK_CORE 0          // Display and config load while loop's core brings up BLE
+#define BOOT_TASK_PRIORITY 1
+#define BOOT_TASK_STACK_SIZE 4096
+#define BOOT_ADVERTISING_BUDGET_MS 600  // Regression limits for the BOOT summary line
+#define BOOT_READY_BUDGET_MS 700
+#define RENDER_TASK_CORE 0        // Matrix SPI off loop()'s core
+#define RENDER_TASK_PRIORITY 1    // Below the MIDI TX task
+#define RENDER_DEADLINE_MS 20     // Frames drawn later than this count as late
+#define RENDER_IDLE_TIMEOUT_MS 100
+#define MATRIX_SCROLL_STEP_MS 60    // One column per step for text wider than the chain
+#define MATRIX_TEXT_HOLD_MS 1500    // Text that fits is shown this long
+#define MATRIX_BENCHMARK_FRAMES 200 // Frames with every row changed for the 'm' command
 
-// 8x8 Matrix Display Patterns
-const byte digitPatterns_8x8[10][8] = {
-  // 0
-  {0b00111100, 0b01100110, 0b01101110, 0b01110110, 0b01100110, 0b01100110, 0b00111100, 0b00000000},
-  // 1  
-  {0b00011000, 0b00111000, 0b00011000, 0b00011000, 0b00011000, 0b00011000, 0b01111110, 0b00000000},
-  // 2
-  {0b00111100, 0b01100110, 0b00000110, 0b00001100, 0b00110000, 0b01100000, 0b01111110, 0b00000000},
-  // 3
-  {0b00111100, 0b01100110, 0b00000110, 0b00011100, 0b00000110, 0b01100110, 0b00111100, 0b00000000},
-  // 4
-  {0b00001100, 0b00011100, 0b00101100, 0b01001100, 0b01111110, 0b00001100, 0b00001100, 0b00000000},
-  // 5
-  {0b01111110, 0b01100000, 0b01111100, 0b00000110, 0b00000110, 0b01100110, 0b00111100, 0b00000000},
-  // 6
-  {0b00111100, 0b01100110, 0b01100000, 0b01111100, 0b01100110, 0b01100110, 0b00111100, 0b00000000},
-  // 7
-  {0b01111110, 0b00000110, 0b00001100, 0b00011000, 0b00110000, 0b00110000, 0b00110000, 0b00000000},
-  // 8
-  {0b00111100, 0b01100110, 0b01100110, 0b00111100, 0b01100110, 0b01100110, 0b00111100, 0b00000000},
-  // 9
-  {0b00111100, 0b01100110, 0b01100110, 0b00111110, 0b00000110, 0b01100110, 0b00111100, 0b00000000}
-};
-
-// Special patterns
-const byte batteryPatterns[6][8] = {
-  // Battery 0%
-  {0b11111111, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b11111111},
-  // Battery 20%  
-  {0b11111111, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b11111111, 0b11111111},
-  // Battery 40%
-  {0b11111111, 0b10000001, 0b10000001, 0b10000001, 0b10000001, 0b11111111, 0b11111111, 0b11111111},
-  // Battery 60%
-  {0b11111111, 0b10000001, 0b10000001, 0b10000001, 0b11111111, 0b11111111, 0b11111111, 0b11111111},
-  // Battery 80%
-  {0b11111111, 0b10000001, 0b10000001, 0b11111111, 0b11111111, 0b11111111, 0b11111111, 0b11111111},
-  // Battery 100%
-  {0b11111111, 0b10000001, 0b11111111, 0b11111111, 0b11111111, 0b11111111, 0b11111111, 0b11111111}
+// Advertising schedule after boot or disconnect, slower and quieter each step
+// Intervals in 0.625 ms units, duration 0 = until a host connects
+const AdvertisingStep advertisingSchedule[] = {
+  {"directed",  ADV_DIRECTED,  0x0006, 0x0006, ESP_PWR_LVL_P9, 1280},
+  {"whitelist", ADV_WHITELIST, 0x0020, 0x0030, ESP_PWR_LVL_P6, 10000},
+  {"fast",      ADV_OPEN,      0x0020, 0x0030, ESP_PWR_LVL_P6, 30000},   // 20-30 ms
+  {"medium",    ADV_OPEN,      0x00F4, 0x0110, ESP_PWR_LVL_P3, 120000},  // 152.5-170 ms
+  {"slow",      ADV_OPEN,      0x0664, 0x0800, ESP_PWR_LVL_N0, 0}        // 1022.5-1280 ms
 };
 
-const byte pairingPattern[8] = {0b01110011, 0b01100110, 0b01100110, 0b01110011, 0b01100000, 0b01100000, 0b01100000, 0b00000000}; // P
-const byte channelCPattern[8] = {0b00111100, 0b01100110, 0b01100000, 0b01100000, 0b01100000, 0b01100110, 0b00111100, 0b00000000}; // C
-
 // Display Modes
 enum DisplayMode {
   MODE_CHANNEL,
@@ -92,52 +107,152 @@ enum DisplayMode {
   MODE_ERROR
 };
 
+// Button Modes
+enum ButtonMode {
+  BUTTON_MODE_FIRE_ON_PRESS,  // CC sent on the first valid falling edge (lockout debounce)
+  BUTTON_MODE_DISAMBIGUATE    // CC sent on release, once long press is ruled out
+};
+
+// Timeline outputs and the matrix frames they step through, the LEDs run
+// on LEDC
+enum AnimationOutput {
+  ANIM_MATRIX  // Values are GlyphAtlas screens
+};
+
+// Pairing: P blinks, the two LEDs alternate with it (startPairingBlink())
+const Keyframe pairingMatrixKeys[] = {
+  {0, GlyphAtlas::SCREEN_PAIRING}, {BLINK_INTERVAL_MS, GlyphAtlas::SCREEN_BLANK}
+};
+const TimelineTrack pairingTracks[] = {
+  {ANIM_MATRIX, pairingMatrixKeys, 2, 2 * BLINK_INTERVAL_MS}
+};
+const Animation pairingBlink = {"pairing", pairingTracks, 1, 0};
+const Animation pairingWindow = {"pairing window", pairingTracks, 1, 5000};  // B1+B2
+
+const Keyframe resetKeys[] = {{0, GlyphAtlas::SCREEN_RESET}};
+const TimelineTrack resetTracks[] = {{ANIM_MATRIX, resetKeys, 1, 0}};
+const Animation resetScreen = {"factory reset", resetTracks, 1, 2000};
+
+// Kept in RTC memory across deep sleep so a wake skips the NVS reads
+struct WakeState {
+  uint8_t midiChannel;
+  uint8_t ccNumbers[6];
+  uint8_t buttonModes[6];
+  uint8_t displayMode;
+};
+
 // Global Variables
 Preferences preferences;
 BLEServer* pServer = NULL;
 BLECharacteristic* pCharacteristic = NULL;
 bool deviceConnected = false;
 bool oldDeviceConnected = false;
-MD_MAX72XX mx = MD_MAX72XX(MD_MAX72XX::GENERIC_HW, MAX7219_CS, 1);
+MD_MAX72XX mx = MD_MAX72XX(MD_MAX72XX::GENERIC_HW, MAX7219_CS, MAX7219_MODULES);
+MatrixFramebuffer matrix;  // All drawing goes through it, mx only for control()
+RenderTask renderer;       // Frames from loop(), drawn into matrix on core 0
+MatrixScroller scroller;   // Text on the panel, owns it while showing
 
 // Function Prototypes
 void displayMatrix(const byte pattern[8]);
-void displayDigit(int number);
+void renderMatrixFrame(const uint8_t* frame, void* context);
 void displayOff();
 void updateChannelDisplay();
 void showBatteryLevel();
-void blinkDisplay();
 void readBatteryVoltage();
-void handleButton(int index);
+void handleButtonEdge(int index, bool level, int64_t timeUs);
+void handleButton(int index, int64_t nowUs);
+bool isAnyButtonActive();
+void acceptButtonState(int index, bool level, int64_t timeUs);
+void handleButtonPressed(int index, int64_t timeUs);
+void handleButtonReleased(int index, int64_t timeUs);
+bool handleCombo(int index);
 void handleShortPress(int index);
 void handleLongPress(int index);
 void enterPairingMode();
 void factoryReset();
 void checkSleepTimeout();
 void enterDeepSleep();
-void sendMidiControlChange(uint8_t channel, uint8_t control, uint8_t value);
+void sendMidiControlChange(uint8_t channel, uint8_t control, uint8_t value, int64_t timeUs);
+void handleSerialCommand();
 void flashActivityLED();
-void connectionLightShow();
+void showChargingLED();
+void ledPatternDone(uint8_t led);
+void startPairingBlink(const Animation& animation, Timeline::DoneFunction onDone);
+void stopPairingBlink();
+void writeAnimationOutput(uint8_t output, uint8_t value);
+void endPairingWindow();
+void completeFactoryReset();
+void handleMidiMessage(const MidiMessage& message);
+void benchmarkWorkload(void* context);
+void runMatrixBenchmark();
+void replayWakePress();
+void bootTask(void* arg);
+void loadDisplayAndConfig();
+ButtonMode toButtonMode(uint8_t value, ButtonMode fallback);
 
 // Button Structure
 struct Button {
   uint8_t pin;
   bool pressed;
   bool longPressed;
-  unsigned long pressTime;
-  unsigned long lastDebounceTime;
-  bool lastState;
+  int64_t pressTimeUs;   // Timestamp of the accepted press edge
+  int64_t lastEdgeUs;    // Timestamp of the last raw edge seen by the ISR
+  int64_t lastAcceptUs;  // Timestamp of the last accepted edge (lockout)
+  bool lastState;        // Level after the last raw edge
+  ButtonMode mode;
+  bool comboHandled;     // Press consumed by a B1+B2 / B3+B4 combination
 };
 
 Button buttons[6] = {
-  {PIN_BUTTON_1, false, false, 0, 0, HIGH},
-  {PIN_BUTTON_2, false, false, 0, 0, HIGH},
-  {PIN_BUTTON_3, false, false, 0, 0, HIGH},
-  {PIN_BUTTON_4, false, false, 0, 0, HIGH},
-  {PIN_BUTTON_5, false, false, 0, 0, HIGH},
-  {PIN_BUTTON_6, false, false, 0, 0, HIGH}
+  {PIN_BUTTON_1, false, false, 0, 0, 0, HIGH, BUTTON_MODE_FIRE_ON_PRESS, false},
+  {PIN_BUTTON_2, false, false, 0, 0, 0, HIGH, BUTTON_MODE_FIRE_ON_PRESS, false},
+  {PIN_BUTTON_3, false, false, 0, 0, 0, HIGH, BUTTON_MODE_FIRE_ON_PRESS, false},
+  {PIN_BUTTON_4, false, false, 0, 0, 0, HIGH, BUTTON_MODE_FIRE_ON_PRESS, false},
+  {PIN_BUTTON_5, false, false, 0, 0, 0, HIGH, BUTTON_MODE_DISAMBIGUATE, false},  // Long press = channel
+  {PIN_BUTTON_6, false, false, 0, 0, 0, HIGH, BUTTON_MODE_DISAMBIGUATE, false}   // Long press = channel
 };
 
+// Timestamped GPIO edges for the six footswitches
+EdgeCapture edgeCapture;
+
+// BLE-MIDI messages queued by the loop, notified by the MIDI TX task under
+// flow control
+MidiTransmitter midiTx;
+
+// Messages written by the host (Program Change, CC feedback from the DAW)
+MidiParser midiParser;
+
+// Connection interval negotiation and the parameters actually granted
+ConnectionManager connectionManager;
+TxPowerControl txPowerControl;
+
+// Bonding, whitelist and directed advertising towards the last host
+ReconnectManager reconnectManager;
+
+// 80 MHz baseline, full speed around presses, MIDI and redraws, light sleep
+// between connection events
+PowerManager powerManager;
+
+// ULP wake-up on any footswitch, RTC state cache and waking press replay
+WakeManager wakeManager;
+BLE2902* pMidiCccd = nullptr;
+WakeState wakeState;
+bool wakeStateRestored = false;
+
+// Startup phase timings, display and config load run beside BLE init
+BootProfiler bootProfiler;
+
+// Matrix animations, stepped from loop()
+Timeline timeline;
+
+// Activity and charging LEDs, patterns run by the LEDC peripheral
+LedController leds;
+SemaphoreHandle_t bootTaskDone = NULL;
+
+// Preferences keys, no String building at boot
+const char* const ccKeys[6] = {"cc0", "cc1", "cc2", "cc3", "cc4", "cc5"};
+const char* const modeKeys[6] = {"mode0", "mode1", "mode2", "mode3", "mode4", "mode5"};
+
 // State Variables
 uint8_t midiChannel = 1;
 uint8_t ccNumbers[6] = {1, 2, 3, 4, 5, 6};
@@ -146,10 +261,58 @@ bool isCharging = false;
 unsigned long lastActivityTime = 0;
 unsigned long lastBatteryReadTime = 0;
 unsigned long batteryDisplayEndTime = 0;
-unsigned long lastBlinkTime = 0;
-unsigned long activityLEDOffTime = 0;
 DisplayMode currentDisplayMode = MODE_PAIRING;
-bool blinkState = false;
+
+// GATT server events not exposed by BLEServerCallbacks
+void gattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
+  switch (event) {
+    case ESP_GATTS_MTU_EVT:
+      midiTx.setMtu(param->mtu.mtu);
+      Serial.print("BLE MTU negotiated: ");
+      Serial.println(param->mtu.mtu);
+      break;
+    case ESP_GATTS_DISCONNECT_EVT:
+      connectionManager.onDisconnect();
+      txPowerControl.onDisconnect();
+      midiTx.setMtu(23);  // Default ATT MTU until the next exchange
+      midiTx.onDisconnect();
+      midiParser.reset();
+      break;
+    case ESP_GATTS_CONGEST_EVT:
+      midiTx.onCongestion(param->congest.congested);
+      break;
+    case ESP_GATTS_CONF_EVT:
+      // Also sent for notifications, with the status of the L2CAP write
+      if (pCharacteristic && param->conf.handle == pCharacteristic->getHandle()) {
+        midiTx.onNotifyResult(param->conf.status);
+        if (param->conf.status != ESP_GATT_OK && param->conf.status != ESP_GATT_CONGESTED) {
+          txPowerControl.onLinkTrouble();
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// GAP events not exposed by the Arduino BLE classes
+void gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  connectionManager.onGapEvent(event, param);
+  txPowerControl.onGapEvent(event, param);
+  reconnectManager.onGapEvent(event, param);
+}
+
+// Host writes are decoded in the BLE task, without heap use
+class MidiCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* characteristic) override {
+      midiParser.parse(characteristic->getData(), characteristic->getLength());
+    }
+    
+    // Synchronous notify() outcome, failures are retried by the TX task
+    void onStatus(BLECharacteristic* characteristic, Status status, uint32_t code) override {
+      midiTx.onNotifyStatus(status);
+    }
+};
 
 // BLE Server Callbacks
 class MyServerCallbacks: public BLEServerCallbacks {
@@ -158,17 +321,19 @@ class MyServerCallbacks: public BLEServerCallbacks {
       Serial.println("*** BLE DEVICE CONNECTED ***");
       Serial.print("Connected devices count: ");
       Serial.println(pServer->getConnectedCount());
-      
-      // Lancer le show de lumières de connexion
-      connectionLightShow();
-      
-      // Passer du mode pairing au mode channel
-      currentDisplayMode = MODE_CHANNEL;
-      updateChannelDisplay();
+      // Light show and channel display start from loop(), not the BLE task
     };
 
+    // Ask for a short connection interval, the advertised one is only a hint
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override {
+      connectionManager.onConnect(param);
+      txPowerControl.onConnect(param);
+      reconnectManager.onConnect();
+    }
+
     void onDisconnect(BLEServer* pServer) override {
       deviceConnected = false;
+      reconnectManager.onDisconnect();
       Serial.println("*** BLE DEVICE DISCONNECTED ***");
       Serial.print("Reason: Connection timeout or client disconnect");
       // Retourner en mode pairing avec LEDs alternées
@@ -179,127 +344,206 @@ class MyServerCallbacks: public BLEServerCallbacks {
 
 void setup() {
   Serial.begin(115200);
+  bootProfiler.setBudgets(BOOT_ADVERTISING_BUDGET_MS, BOOT_READY_BUDGET_MS);
   
-  // Initialize MAX7219 Matrix Display
-  mx.begin();            // Initialize MAX7219
-  mx.control(MD_MAX72XX::INTENSITY, 8);  // Set brightness (0-15)
-  mx.clear();            // Clear display
-  Serial.println("MAX7219 Matrix Display initialized");
+  {
+    BootPhase phase(bootProfiler, "Pins");
+    
+    // Initialize LED Pins, off until a pattern is set
+    const uint8_t ledPins[2] = {PIN_LED_ACTIVITY, PIN_LED_CHARGING};
+    leds.begin(ledPins, 2, ledPatternDone);
+    
+    // Initialize Button Pins, back from the ULP first after a deep sleep
+    uint8_t buttonPins[6];
+    for (int i = 0; i < 6; i++) {
+      buttonPins[i] = buttons[i].pin;
+    }
+    wakeManager.begin(buttonPins, 6);
+    for (int i = 0; i < 6; i++) {
+      pinMode(buttons[i].pin, INPUT_PULLUP);
+    }
+    edgeCapture.begin(buttonPins, 6);
+    
+    // Initialize Analog Pins
+    pinMode(PIN_BATTERY_VOLTAGE, INPUT);
+    // pinMode(PIN_CHARGING_STATUS, INPUT_PULLUP);  // Non utilisé (TC4056 4-pins)
+  }
   
-  // Initialize LED Pins
-  pinMode(PIN_LED_CHARGING, OUTPUT);
-  pinMode(PIN_LED_ACTIVITY, OUTPUT);
-  digitalWrite(PIN_LED_CHARGING, LOW);
-  digitalWrite(PIN_LED_ACTIVITY, LOW);
+  // Display and configuration on the other core while BLE comes up here
+  bootTaskDone = xSemaphoreCreateBinary();
+  if (xTaskCreatePinnedToCore(bootTask, "boot", BOOT_TASK_STACK_SIZE, NULL,
+                              BOOT_TASK_PRIORITY, NULL, BOOT_TASK_CORE) != pdPASS) {
+    Serial.println("Boot task creation failed, loading in sequence");
+    loadDisplayAndConfig();
+    xSemaphoreGive(bootTaskDone);
+  }
   
-  Serial.println("Hardware initialization completed");
+  // Initialize BLE with power settings
+  {
+    BootPhase phase(bootProfiler, "BLE stack");
+    BLEDevice::init("DestriMidi");
+    BLEDevice::setMTU(BLE_MIDI_MTU);
+    BLEDevice::setCustomGattsHandler(gattsEventHandler);
+    BLEDevice::setCustomGapHandler(gapEventHandler);
+    connectionManager.begin(BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX,
+                            BLE_SLAVE_LATENCY, BLE_SUPERVISION_TIMEOUT);
+    BLEDevice::setPower(BLE_TX_POWER_MAX); // Connections start at max, txPowerControl lowers it
+    txPowerControl.begin(BLE_TX_POWER_MIN, BLE_TX_POWER_MAX);
+  }
   
-  // Initialize Button Pins
-  for (int i = 0; i < 6; i++) {
-    pinMode(buttons[i].pin, INPUT_PULLUP);
+  {
+    BootPhase phase(bootProfiler, "GATT MIDI service");
+    pServer = BLEDevice::createServer();
+    pServer->setCallbacks(new MyServerCallbacks());
+    
+    BLEService *pService = pServer->createService(MIDI_SERVICE_UUID);
+    pCharacteristic = pService->createCharacteristic(
+                        MIDI_CHARACTERISTIC_UUID,
+                        BLECharacteristic::PROPERTY_READ   |
+                        BLECharacteristic::PROPERTY_WRITE  |
+                        BLECharacteristic::PROPERTY_NOTIFY |
+                        BLECharacteristic::PROPERTY_WRITE_NR
+                      );
+    pMidiCccd = new BLE2902();
+    pCharacteristic->addDescriptor(pMidiCccd);
+    pCharacteristic->setCallbacks(new MidiCallbacks());
+    pService->start();
   }
   
-  // Initialize Analog Pins
-  pinMode(PIN_BATTERY_VOLTAGE, INPUT);
-  // pinMode(PIN_CHARGING_STATUS, INPUT_PULLUP);  // Non utilisé (TC4056 4-pins)
+  {
+    // Directed advertising at the bonded host first, then the slower schedule steps
+    BootPhase phase(bootProfiler, "Advertising");
+    BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
+    pAdvertising->addServiceUUID(MIDI_SERVICE_UUID);
+    pAdvertising->setScanResponse(true);
+    pAdvertising->setMinPreferred(0x06);
+    pAdvertising->setMaxPreferred(0x12);
+    reconnectManager.begin(pAdvertising, advertisingSchedule,
+                           sizeof(advertisingSchedule) / sizeof(advertisingSchedule[0]));
+    reconnectManager.start();
+  }
+  bootProfiler.markAdvertising();
+  Serial.println("BLE Advertising started - Device should be visible now!");
   
-  // Show startup pattern
-  displayMatrix(pairingPattern);
-  delay(500);
-  displayOff();
-  delay(200);
+  {
+    BootPhase phase(bootProfiler, "Power and MIDI TX");
+    if (powerManager.begin(CPU_FREQ_MAX_MHZ, CPU_FREQ_MIN_MHZ, LIGHT_SLEEP_ENABLED) &&
+        powerManager.isLightSleepEnabled()) {
+      edgeCapture.enableWakeup();
+    }
+    midiTx.setPowerLock(powerManager.getActiveLock());
+    midiTx.begin(pCharacteristic, MIDI_TX_TASK_CORE, MIDI_TX_TASK_PRIORITY);
+  }
   
-  // Load preferences
-  preferences.begin("destrimidi", false);
-  midiChannel = preferences.getUChar("channel", 1);
-  for (int i = 0; i < 6; i++) {
-    String key = "cc" + String(i);
-    ccNumbers[i] = preferences.getUChar(key.c_str(), i + 1);
+  // Footswitches go live once the configuration is in
+  {
+    BootPhase phase(bootProfiler, "Wait for boot task");
+    xSemaphoreTake(bootTaskDone, portMAX_DELAY);
   }
   
-  // Initialize BLE with power settings
-  Serial.println("Starting BLE initialization...");
-  BLEDevice::init("DestriMidi");
-  BLEDevice::setPower(ESP_PWR_LVL_P9); // Max power for stable connection
-  Serial.println("BLE Device initialized");
-  
-  pServer = BLEDevice::createServer();
-  Serial.println("BLE Server created");
-  
-  pServer->setCallbacks(new MyServerCallbacks());
-  Serial.println("BLE Server callbacks set");
-  
-  BLEService *pService = pServer->createService(MIDI_SERVICE_UUID);
-  Serial.println("BLE Service created");
-  
-  pCharacteristic = pService->createCharacteristic(
-                      MIDI_CHARACTERISTIC_UUID,
-                      BLECharacteristic::PROPERTY_READ   |
-                      BLECharacteristic::PROPERTY_WRITE  |
-                      BLECharacteristic::PROPERTY_NOTIFY |
-                      BLECharacteristic::PROPERTY_WRITE_NR
-                    );
-  Serial.println("BLE Characteristic created");
-  
-  pCharacteristic->addDescriptor(new BLE2902());
-  Serial.println("BLE Descriptor added");
-  
-  pService->start();
-  Serial.println("BLE Service started");
-  
-  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
-  pAdvertising->addServiceUUID(MIDI_SERVICE_UUID);
-  pAdvertising->setScanResponse(true);
-  pAdvertising->setMinPreferred(0x06);
-  pAdvertising->setMaxPreferred(0x12);
-  
-  // Configuration pour reconnexion automatique Mac
-  pAdvertising->setMinInterval(0x20);
-  pAdvertising->setMaxInterval(0x40);
-  Serial.println("BLE Advertising configured");
-  
-  BLEDevice::startAdvertising();
-  Serial.println("BLE Advertising started - Device should be visible now!");
+  if (wakeStateRestored && wakeState.displayMode == MODE_CHANNEL) {
+    // Back to the screen shown before the deep sleep
+    currentDisplayMode = MODE_CHANNEL;
+    updateChannelDisplay();
+  } else {
+    // Start in pairing mode - show blinking P
+    currentDisplayMode = MODE_PAIRING;
+    Serial.println("Starting in pairing mode - P will blink until connected");
+  }
   
-  // Start in pairing mode - show blinking P
-  currentDisplayMode = MODE_PAIRING;
-  Serial.println("Starting in pairing mode - P will blink until connected");
+  timeline.begin(writeAnimationOutput);
+  lastActivityTime = millis();
+  bootProfiler.markReady();
+  bootProfiler.printSummary();
+}
+
+void bootTask(void* arg) {
+  loadDisplayAndConfig();
+  xSemaphoreGive(bootTaskDone);
+  vTaskDelete(NULL);
+}
+
+void loadDisplayAndConfig() {
+  {
+    BootPhase phase(bootProfiler, "Display init");
+    mx.begin();            // Initialize MAX7219
+    mx.control(MD_MAX72XX::INTENSITY, 8);  // Set brightness (0-15)
+    mx.clear();            // Clear display
+    matrix.begin(&mx, MAX7219_MODULES);
+    renderer.begin(matrix.getFrameSize(), renderMatrixFrame, nullptr, RENDER_DEADLINE_MS,
+                   RENDER_TASK_CORE, RENDER_TASK_PRIORITY);
+    scroller.begin(&renderer, MAX7219_MODULES, MATRIX_SCROLL_STEP_MS, MATRIX_TEXT_HOLD_MS);
+  }
+  
+  // Load preferences, from RTC memory when waking from deep sleep
+  BootPhase phase(bootProfiler, "Config load");
+  preferences.begin("destrimidi", false);
+  wakeStateRestored = wakeManager.loadState(&wakeState, sizeof(wakeState));
+  if (wakeStateRestored) {
+    midiChannel = wakeState.midiChannel;
+    memcpy(ccNumbers, wakeState.ccNumbers, sizeof(ccNumbers));
+    for (int i = 0; i < 6; i++) {
+      buttons[i].mode = toButtonMode(wakeState.buttonModes[i], buttons[i].mode);
+    }
+    Serial.println("Configuration restored from RTC memory");
+    return;
+  }
   
+  // Startup pattern, cold boot only: the first frame of the pairing blink,
+  // loop() carries on from it instead of setup() waiting 700 ms
+  displayMatrix(GlyphAtlas::screen(GlyphAtlas::SCREEN_PAIRING).rows);
   
-  lastActivityTime = millis();
+  midiChannel = preferences.getUChar("channel", 1);
+  if (midiChannel < GlyphAtlas::MIN_CHANNEL || midiChannel > GlyphAtlas::MAX_CHANNEL) {
+    midiChannel = 1;
+  }
+  for (int i = 0; i < 6; i++) {
+    ccNumbers[i] = preferences.getUChar(ccKeys[i], i + 1);
+    buttons[i].mode = toButtonMode(preferences.getUChar(modeKeys[i], buttons[i].mode), buttons[i].mode);
+  }
+}
+
+// Stored modes come from NVS or RTC memory, unknown values keep the compiled default
+ButtonMode toButtonMode(uint8_t value, ButtonMode fallback) {
+  switch (value) {
+    case BUTTON_MODE_FIRE_ON_PRESS:
+    case BUTTON_MODE_DISAMBIGUATE:
+      return (ButtonMode)value;
+    default:
+      return fallback;
+  }
 }
 
 // 8x8 Matrix Display Functions
 void displayMatrix(const byte pattern[8]) {
-  for (int i = 0; i < 8; i++) {
-    mx.setRow(i, pattern[i]);
-  }
+  // Text has the panel until it ends, loop() redraws the mode after it
+  if (scroller.isActive()) return;
+  
+  // 8x8 screens on the leftmost module, the rest of the chain blank
+  uint8_t frame[MatrixFramebuffer::MAX_MODULES * MatrixFramebuffer::ROWS] = {0};
+  memcpy(frame + (MAX7219_MODULES - 1) * MatrixFramebuffer::ROWS, pattern, MatrixFramebuffer::ROWS);
+  
+  // Only a copy and a swap here, the SPI happens on the render task
+  renderer.publish(frame);
 }
 
-void displayDigit(int number) {
-  if (number >= 0 && number <= 9) {
-    displayMatrix(digitPatterns_8x8[number]);
-  }
+void renderMatrixFrame(const uint8_t* frame, void* context) {
+  // Same frame as on the chip: no SPI, no CPU boost
+  matrix.setFrame(frame);
+  if (!matrix.isDirty()) return;
+  
+  PowerLock boost(powerManager);
+  matrix.flush();
 }
 
 void displayOff() {
-  mx.clear();
+  displayMatrix(GlyphAtlas::screen(GlyphAtlas::SCREEN_BLANK).rows);
 }
 
 void updateChannelDisplay() {
-  // Affichage canal avec "C" suivi du numéro
-  if (midiChannel <= 9) {
-    // Afficher "C" + chiffre pour canaux 1-9
-    byte channelPattern[8];
-    // Combiner pattern "C" avec chiffre
-    for (int i = 0; i < 8; i++) {
-      channelPattern[i] = (channelCPattern[i] >> 1) | (digitPatterns_8x8[midiChannel][i] << 4);
-    }
-    displayMatrix(channelPattern);
-  } else {
-    // Pour canaux >9, afficher juste le chiffre
-    displayDigit(midiChannel);
-  }
+  // Affichage canal : "C" + chiffre pour 1-9, deux chiffres pour 10-16
+  scroller.stop();
+  displayMatrix(GlyphAtlas::channel(midiChannel).rows);
 }
 
 void showBatteryLevel() {
@@ -307,68 +551,63 @@ void showBatteryLevel() {
   batteryPercent = constrain(batteryPercent, 0, 100);
   int batteryLevel = batteryPercent / 20;  // 0-5 levels
   
-  if (batteryLevel >= 0 && batteryLevel <= 5) {
-    displayMatrix(batteryPatterns[batteryLevel]);
+  if (batteryLevel >= 0 && batteryLevel < GlyphAtlas::BATTERY_LEVELS) {
+    displayMatrix(GlyphAtlas::battery(batteryLevel).rows);
   }
 }
 
-void blinkDisplay() {
-  if (millis() - lastBlinkTime > BLINK_INTERVAL_MS) {
-    blinkState = !blinkState;
-    lastBlinkTime = millis();
-    
-    if (currentDisplayMode == MODE_PAIRING) {
-      if (blinkState) {
-        displayMatrix(pairingPattern);
-        // LEDs clignotent en alternance pendant le pairing
-        digitalWrite(PIN_LED_ACTIVITY, HIGH);
-        digitalWrite(PIN_LED_CHARGING, LOW);
-      } else {
-        displayOff();
-        // LEDs inversées
-        digitalWrite(PIN_LED_ACTIVITY, LOW);
-        digitalWrite(PIN_LED_CHARGING, HIGH);
-      }
-    }
+void flashActivityLED() {
+  leds.flash(LED_ACTIVITY, 1000);  // 1 seconde
+}
+
+void showChargingLED() {
+  // En charge : LED verte clignotante, sinon éteinte
+  if (isCharging) {
+    leds.blink(LED_CHARGING, 2000, 1000);
+  } else {
+    leds.set(LED_CHARGING, 0);
   }
 }
 
-void flashActivityLED() {
-  digitalWrite(PIN_LED_ACTIVITY, HIGH);
-  activityLEDOffTime = millis() + 1000; // 1 seconde
+void ledPatternDone(uint8_t led) {
+  // A timed pattern borrowed the charging LED, give it back
+  if (led == LED_CHARGING) {
+    showChargingLED();
+  }
 }
 
-void connectionLightShow() {
-  Serial.println("Starting connection LED light show...");
-  
-  // LEDs indépendantes qui se superposent naturellement
-  // LED jaune: 1x par seconde pendant 5 secondes = 5 flashs total
-  // LED verte: 3x par seconde pendant 5 secondes = 15 flashs total
-  
-  unsigned long startTime = millis();
-  unsigned long duration = 5000; // 5 secondes
+void startPairingBlink(const Animation& animation, Timeline::DoneFunction onDone) {
+  // P on the timeline, the LEDs alternate in hardware in step with it
+  timeline.stop(pairingBlink);
+  timeline.play(animation, onDone);
+  leds.blink(LED_ACTIVITY, 2 * BLINK_INTERVAL_MS, BLINK_INTERVAL_MS, false, animation.durationMs);
+  leds.blink(LED_CHARGING, 2 * BLINK_INTERVAL_MS, BLINK_INTERVAL_MS, true, animation.durationMs);
+}
+
+void stopPairingBlink() {
+  if (!timeline.isPlaying(pairingBlink) && !timeline.isPlaying(pairingWindow)) return;
   
-  while (millis() - startTime < duration) {
-    unsigned long elapsed = millis() - startTime;
-    
-    // LED jaune : clignote toutes les 1000ms (1x par seconde)
-    unsigned long yellowCycle = elapsed % 1000;
-    bool yellowOn = (yellowCycle < 100); // Flash de 100ms
-    
-    // LED verte : clignote toutes les 333ms (3x par seconde)  
-    unsigned long greenCycle = elapsed % 333;
-    bool greenOn = (greenCycle < 100); // Flash de 100ms
-    
-    digitalWrite(PIN_LED_ACTIVITY, yellowOn ? HIGH : LOW);
-    digitalWrite(PIN_LED_CHARGING, greenOn ? HIGH : LOW);
-    
-    delay(10); // Petite pause pour la boucle
+  timeline.stop(pairingBlink);
+  timeline.stop(pairingWindow);
+  leds.set(LED_ACTIVITY, 0);
+  showChargingLED();
+}
+
+void writeAnimationOutput(uint8_t output, uint8_t value) {
+  switch (output) {
+    case ANIM_MATRIX:
+      if (value != Timeline::RELEASE) {
+        scroller.stop();  // Pairing and reset screens win over text
+        displayMatrix(GlyphAtlas::screen(value).rows);
+      } else if (currentDisplayMode == MODE_CHANNEL) {
+        updateChannelDisplay();
+      } else if (currentDisplayMode == MODE_BATTERY) {
+        showBatteryLevel();
+      } else {
+        displayOff();
+      }
+      break;
   }
-  
-  // Éteindre toutes les LEDs
-  digitalWrite(PIN_LED_ACTIVITY, LOW);
-  digitalWrite(PIN_LED_CHARGING, LOW);
-  Serial.println("Connection LED light show complete");
 }
 
 // Battery and Charging Functions
@@ -403,133 +642,193 @@ void readBatteryVoltage() {
     lastBatteryDebug = millis();
   }
   
-  // Update charging LED - Only green LED for charging indication
-  if (isCharging) {
-    // En charge : LED verte clignotante
-    digitalWrite(PIN_LED_CHARGING, (millis() / 1000) % 2);
-  } else if (batteryVoltage > 4.1) {
-    // Charge terminée : LED verte fixe pendant 5 secondes
-    static unsigned long chargeCompleteTime = 0;
-    static bool wasCharging = false;
-    
-    if (wasCharging && !isCharging) {
-      chargeCompleteTime = millis();
-    }
-    
-    if (millis() - chargeCompleteTime < 5000) {
-      digitalWrite(PIN_LED_CHARGING, HIGH);
+  // Update charging LED on state changes only, LEDC runs the pattern
+  static bool wasCharging = false;
+  if (isCharging != wasCharging) {
+    wasCharging = isCharging;
+    if (!isCharging && batteryVoltage > 4.1) {
+      // Charge terminée : LED verte fixe pendant 5 secondes
+      leds.flash(LED_CHARGING, 5000);
     } else {
-      digitalWrite(PIN_LED_CHARGING, LOW);
+      showChargingLED();
     }
-    
-    wasCharging = isCharging;
-  } else {
-    // Fonctionnement normal : LED éteinte
-    digitalWrite(PIN_LED_CHARGING, LOW);
   }
 }
 
 // Button Handling Functions
-void handleButton(int index) {
+void handleButtonEdge(int index, bool level, int64_t timeUs) {
   Button& btn = buttons[index];
-  bool currentState = digitalRead(btn.pin);
+  btn.lastState = level;
+  btn.lastEdgeUs = timeUs;
   
-  if (currentState != btn.lastState) {
-    btn.lastDebounceTime = millis();
-    Serial.print("Button ");
-    Serial.print(index + 1);
-    Serial.print(" state change: ");
-    Serial.println(currentState == LOW ? "PRESSED" : "RELEASED");
-  }
-  
-  if ((millis() - btn.lastDebounceTime) > BUTTON_DEBOUNCE_MS) {
-    if (currentState == LOW && !btn.pressed) {
-      btn.pressed = true;
-      btn.pressTime = millis();
-      lastActivityTime = millis();
-      Serial.print("Button ");
-      Serial.print(index + 1);
-      Serial.println(" press STARTED");
-    } else if (currentState == HIGH && btn.pressed) {
-      unsigned long pressDuration = millis() - btn.pressTime;
-      
-      // Ignorer les pressions trop courtes (probable rebond)
-      if (pressDuration < 30) {
-        Serial.print("Button ");
-        Serial.print(index + 1);
-        Serial.println(" press too short - ignored");
-        btn.pressed = false;
-        btn.longPressed = false;
-        btn.lastState = currentState;
-        return;
+  // Lockout debounce: the first edge is accepted at its own timestamp, then
+  // further edges are ignored for BUTTON_LOCKOUT_MS
+  if (btn.mode == BUTTON_MODE_FIRE_ON_PRESS &&
+      (timeUs - btn.lastAcceptUs) >= (int64_t)BUTTON_LOCKOUT_MS * 1000) {
+    acceptButtonState(index, level, timeUs);
+  }
+}
+
+void handleButton(int index, int64_t nowUs) {
+  Button& btn = buttons[index];
+  
+  // Safety net for edges lost to a ring overflow
+  bool level = edgeCapture.readLevel(index);
+  if (level != btn.lastState) {
+    btn.lastState = level;
+    btn.lastEdgeUs = nowUs;
+  }
+  
+  bool acceptedState = btn.pressed ? LOW : HIGH;
+  if (btn.lastState != acceptedState) {
+    if (btn.mode == BUTTON_MODE_FIRE_ON_PRESS) {
+      // A bounce that ended in the other state, picked up once the lockout expires
+      if ((nowUs - btn.lastAcceptUs) >= (int64_t)BUTTON_LOCKOUT_MS * 1000) {
+        acceptButtonState(index, btn.lastState, btn.lastEdgeUs);
       }
-      
-      Serial.print("Button ");
-      Serial.print(index + 1);
-      Serial.print(" press ENDED (duration: ");
-      Serial.print(pressDuration);
-      Serial.println("ms)");
-      
-      if (pressDuration >= LONG_PRESS_MS) {
-        // Long press détecté au relâchement
-        Serial.print("Button ");
-        Serial.print(index + 1);
-        Serial.println(" -> LONG PRESS");
-        handleLongPress(index);
-      } else {
-        // Short press au relâchement
-        Serial.print("Button ");
-        Serial.print(index + 1);
-        Serial.println(" -> SHORT PRESS");
-        handleShortPress(index);
+    } else {
+      // Stable-window debounce: no edge for BUTTON_DEBOUNCE_MS since the last one
+      if ((nowUs - btn.lastEdgeUs) > (int64_t)BUTTON_DEBOUNCE_MS * 1000) {
+        acceptButtonState(index, btn.lastState, btn.lastEdgeUs);
       }
-      
-      btn.pressed = false;
-      btn.longPressed = false;
     }
+  }
+  
+  // Long press detected while held
+  if (btn.pressed && !btn.longPressed && (nowUs - btn.pressTimeUs) >= (int64_t)LONG_PRESS_MS * 1000) {
+    btn.longPressed = true;
+    Serial.print("Long press detected on button ");
+    Serial.println(index + 1);
     
-    // Marquer comme long press pendant l'appui (sans traiter l'action)
-    if (btn.pressed && (millis() - btn.pressTime) >= LONG_PRESS_MS && !btn.longPressed) {
-      btn.longPressed = true;
-      Serial.print("Long press detected on button ");
-      Serial.println(index + 1);
+    // Fire-on-press buttons resolve the long press now, the CC already went out
+    if (btn.mode == BUTTON_MODE_FIRE_ON_PRESS && !btn.comboHandled) {
+      handleLongPress(index);
     }
   }
+}
+
+bool isAnyButtonActive() {
+  // Pressed, or an edge still waiting for debounce
+  for (int i = 0; i < 6; i++) {
+    if (buttons[i].pressed || buttons[i].lastState == LOW) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void acceptButtonState(int index, bool level, int64_t timeUs) {
+  Button& btn = buttons[index];
   
-  btn.lastState = currentState;
+  if (level == LOW && !btn.pressed) {
+    btn.lastAcceptUs = timeUs;
+    handleButtonPressed(index, timeUs);
+  } else if (level == HIGH && btn.pressed) {
+    btn.lastAcceptUs = timeUs;
+    handleButtonReleased(index, timeUs);
+  }
 }
 
-void handleShortPress(int index) {
-  Serial.print("handleShortPress called for button ");
-  Serial.println(index + 1);
+void handleButtonPressed(int index, int64_t timeUs) {
+  Button& btn = buttons[index];
+  btn.pressed = true;
+  btn.longPressed = false;
+  btn.comboHandled = false;
+  btn.pressTimeUs = timeUs;
+  lastActivityTime = millis();
+  reconnectManager.onActivity();
   
-  // Check for button combinations
-  if (buttons[0].pressed && buttons[1].pressed) {
-    Serial.println("Button combination B1+B2 -> Entering pairing mode");
-    enterPairingMode();
+  if (!handleCombo(index) && btn.mode == BUTTON_MODE_FIRE_ON_PRESS) {
+    handleShortPress(index);
+  }
+  
+  // Logged after the CC so Serial output never delays the notify
+  Serial.print("Button ");
+  Serial.print(index + 1);
+  Serial.println(" press STARTED");
+}
+
+void handleButtonReleased(int index, int64_t timeUs) {
+  Button& btn = buttons[index];
+  unsigned long pressDuration = (unsigned long)((timeUs - btn.pressTimeUs) / 1000);
+  btn.pressed = false;
+  
+  Serial.print("Button ");
+  Serial.print(index + 1);
+  Serial.print(" press ENDED (duration: ");
+  Serial.print(pressDuration);
+  Serial.println("ms)");
+  
+  if (btn.comboHandled || btn.mode == BUTTON_MODE_FIRE_ON_PRESS) {
+    // Already resolved on the press edge or while held
+    btn.longPressed = false;
+    return;
+  }
+  
+  // Ignorer les pressions trop courtes (probable rebond)
+  if (pressDuration < 30) {
+    Serial.print("Button ");
+    Serial.print(index + 1);
+    Serial.println(" press too short - ignored");
+    btn.longPressed = false;
     return;
   }
   
-  if (buttons[2].pressed && buttons[3].pressed) {
+  if (pressDuration >= LONG_PRESS_MS) {
+    // Long press détecté au relâchement
+    Serial.print("Button ");
+    Serial.print(index + 1);
+    Serial.println(" -> LONG PRESS");
+    handleLongPress(index);
+  } else {
+    // Short press au relâchement
+    Serial.print("Button ");
+    Serial.print(index + 1);
+    Serial.println(" -> SHORT PRESS");
+    handleShortPress(index);
+  }
+  
+  btn.longPressed = false;
+}
+
+bool handleCombo(int index) {
+  // Combinations resolve on the second press edge. A fire-on-press partner has
+  // already sent its CC, the combo only suppresses the second one.
+  int partner = index ^ 1;  // B1<->B2, B3<->B4
+  if (index > 3 || !buttons[partner].pressed) {
+    return false;
+  }
+  buttons[index].comboHandled = true;
+  buttons[partner].comboHandled = true;
+  
+  if (index <= 1) {
+    Serial.println("Button combination B1+B2 -> Entering pairing mode");
+    enterPairingMode();
+  } else {
     Serial.println("Button combination B3+B4 -> Show battery level");
     // Show battery level for 3 seconds
     currentDisplayMode = MODE_BATTERY;
     batteryDisplayEndTime = millis() + BATTERY_DISPLAY_TIME_MS;
+    scroller.stop();
     showBatteryLevel();
-    return;
   }
+  return true;
+}
+
+void handleShortPress(int index) {
+  // Queue MIDI CC first, log afterwards. The MIDI TX task records the
+  // press-to-notify latency once the packet is notified.
+  sendMidiControlChange(midiChannel - 1, ccNumbers[index], 127, buttons[index].pressTimeUs);
+  
+  flashActivityLED();
   
-  // Send MIDI CC
-  Serial.print("Sending MIDI CC: Channel=");
+  Serial.print("MIDI CC: Channel=");
   Serial.print(midiChannel);
   Serial.print(", CC#=");
   Serial.print(ccNumbers[index]);
-  Serial.print(", Value=127");
-  Serial.println();
-  
-  sendMidiControlChange(midiChannel - 1, ccNumbers[index], 127);
-  
-  flashActivityLED();
+  Serial.print(", Value=127 (button ");
+  Serial.print(index + 1);
+  Serial.println(")");
 }
 
 void handleLongPress(int index) {
@@ -541,7 +840,7 @@ void handleLongPress(int index) {
   
   if (index == 4) {  // Button 5 - Channel Down
     Serial.println("Button 5 - Channel DOWN");
-    midiChannel = (midiChannel == 1) ? 9 : midiChannel - 1;
+    midiChannel = (midiChannel == GlyphAtlas::MIN_CHANNEL) ? GlyphAtlas::MAX_CHANNEL : midiChannel - 1;
     preferences.putUChar("channel", midiChannel);
     updateChannelDisplay();
     flashActivityLED();
@@ -549,7 +848,7 @@ void handleLongPress(int index) {
     Serial.println(midiChannel);
   } else if (index == 5) {  // Button 6 - Channel Up  
     Serial.println("Button 6 - Channel UP");
-    midiChannel = (midiChannel == 9) ? 1 : midiChannel + 1;
+    midiChannel = (midiChannel == GlyphAtlas::MAX_CHANNEL) ? GlyphAtlas::MIN_CHANNEL : midiChannel + 1;
     preferences.putUChar("channel", midiChannel);
     updateChannelDisplay();
     flashActivityLED();
@@ -563,53 +862,151 @@ void handleLongPress(int index) {
 }
 
 // MIDI Functions
-void sendMidiControlChange(uint8_t channel, uint8_t control, uint8_t value) {
+void sendMidiControlChange(uint8_t channel, uint8_t control, uint8_t value, int64_t timeUs) {
   if (!deviceConnected) return;
   
-  uint8_t midiPacket[5];
-  midiPacket[0] = 0x80;  // Header
-  midiPacket[1] = 0x80;  // Timestamp
-  midiPacket[2] = 0xB0 | (channel & 0x0F);  // Control Change
-  midiPacket[3] = control & 0x7F;
-  midiPacket[4] = value & 0x7F;
+  uint8_t message[3];
+  message[0] = 0xB0 | (channel & 0x0F);  // Control Change
+  message[1] = control & 0x7F;
+  message[2] = value & 0x7F;
+  
+  // Stamped with the physical event time so the host can undo connection
+  // interval jitter. Coalesced with the rest of this loop pass.
+  if (!midiTx.push(message, 3, MidiPacketBuilder::timestampFromMicros(timeUs), timeUs)) {
+    Serial.println("MIDI TX queue and held events full, CC dropped");
+  }
+}
+
+void handleMidiMessage(const MidiMessage& message) {
+  // Only our channel, the DAW echoes state for every track
+  if (message.status >= 0xF0 || (message.status & 0x0F) != midiChannel - 1) return;
+  
+  switch (message.status & 0xF0) {
+    case 0xC0:
+      Serial.printf("MIDI in: Program Change %d\n", message.data1);
+      flashActivityLED();
+      {
+        // Scrolls on a single module, fits on a 4-module chain
+        char text[MatrixScroller::MAX_TEXT + 1];
+        snprintf(text, sizeof(text), "PC %d", message.data1);
+        scroller.show(text);
+      }
+      break;
+    case 0xB0:
+      // Feedback for one of our footswitch CCs (e.g. effect on/off state)
+      for (int i = 0; i < 6; i++) {
+        if (ccNumbers[i] == message.data1) {
+          Serial.printf("MIDI in: CC#%d = %d (button %d)\n", message.data1, message.data2, i + 1);
+          flashActivityLED();
+          break;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void handleSerialCommand() {
+  if (!Serial.available()) return;
   
-  pCharacteristic->setValue(midiPacket, 5);
-  pCharacteristic->notify();
+  char command = Serial.read();
+  if (command == 's') {
+    // Diagnostics: TX queue, latency and packet coalescing
+    midiTx.printStats();
+    midiParser.printStats();
+    connectionManager.printStats();
+    txPowerControl.printStats();
+    powerManager.printStats();
+    reconnectManager.printStats();
+    timeline.printStats();
+    leds.printStats();
+    renderer.printStats();
+    matrix.printStats();
+    scroller.printStats();
+  } else if (command == 'b') {
+    // Latency and estimated current under each CPU frequency policy
+    powerManager.runBenchmark(benchmarkWorkload, nullptr);
+  } else if (command == 'p') {
+    // Startup phase timings, time-to-advertising and time-to-ready
+    bootProfiler.printSummary();
+  } else if (command == 'm') {
+    // Matrix chain throughput, and what publishing costs loop()
+    runMatrixBenchmark();
+  }
+}
+
+void benchmarkWorkload(void* context) {
+  // One press worth of work without notifying: a CC packet and a redraw
+  static MidiPacketBuilder packet;
+  uint8_t cc[3] = {(uint8_t)(0xB0 | ((midiChannel - 1) & 0x0F)), ccNumbers[0], 127};
+  packet.clear();
+  packet.add(MidiPacketBuilder::timestampFromMillis(millis()), cc, sizeof(cc));
+  updateChannelDisplay();
+}
+
+void runMatrixBenchmark() {
+  scroller.stop();
+  uint8_t frame[MatrixFramebuffer::MAX_MODULES * MatrixFramebuffer::ROWS];
+  uint32_t rowsBefore = matrix.getRowWriteCount();
+  int64_t publishUs = 0;
+  int64_t start = esp_timer_get_time();
+  
+  // Every row of every module changes each frame, one tick apart
+  for (int i = 0; i < MATRIX_BENCHMARK_FRAMES; i++) {
+    memset(frame, (i & 1) ? 0xAA : 0x55, sizeof(frame));
+    int64_t t = esp_timer_get_time();
+    renderer.publish(frame);
+    publishUs += esp_timer_get_time() - t;
+    vTaskDelay(1);
+  }
+  renderer.waitIdle(RENDER_IDLE_TIMEOUT_MS);
+  
+  int64_t elapsedUs = esp_timer_get_time() - start;
+  uint32_t rows = matrix.getRowWriteCount() - rowsBefore;
+  Serial.printf("Matrix benchmark: %d modules, %lu rows in %lu ms = %lu rows/s, "
+                "publish %lu us avg on loop()\n",
+                MAX7219_MODULES, (unsigned long)rows, (unsigned long)(elapsedUs / 1000),
+                (unsigned long)(elapsedUs ? rows * 1000000LL / elapsedUs : 0),
+                (unsigned long)(publishUs / MATRIX_BENCHMARK_FRAMES));
+  renderer.printStats();
+  matrix.printStats();
+  writeAnimationOutput(ANIM_MATRIX, Timeline::RELEASE);
 }
 
 // System Functions
 void enterPairingMode() {
   currentDisplayMode = MODE_PAIRING;
-  BLEDevice::startAdvertising();
-  
-  unsigned long pairingEndTime = millis() + 5000;
-  while (millis() < pairingEndTime) {
-    blinkDisplay();
-    delay(10);
-  }
+  reconnectManager.startPairing();
   
+  // Blink for 5 s, the footswitches stay live meanwhile
+  startPairingBlink(pairingWindow, endPairingWindow);
+}
+
+void endPairingWindow() {
   currentDisplayMode = MODE_CHANNEL;
   updateChannelDisplay();
 }
 
 void factoryReset() {
-  // Show E pattern for reset
-  byte resetPattern[8] = {0b01111110, 0b01100000, 0b01100000, 0b01111100, 0b01100000, 0b01100000, 0b01111110, 0b00000000}; // E
-  displayMatrix(resetPattern);
-  delay(1000);
-  
+  // Show E pattern for reset, the reset itself runs when it ends
+  timeline.play(resetScreen, completeFactoryReset);
+}
+
+void completeFactoryReset() {
   preferences.clear();
+  reconnectManager.clearBonds();
   midiChannel = 1;
   for (int i = 0; i < 6; i++) {
     ccNumbers[i] = i + 1;
   }
   
-  delay(1000);
   ESP.restart();
 }
 
 void checkSleepTimeout() {
-  // Disable sleep if BLE connected to prevent disconnections
+  // Disable sleep if BLE connected to prevent disconnections, light sleep
+  // between connection events saves power instead
   if (deviceConnected) {
     lastActivityTime = millis(); // Reset timer when connected
     return;
@@ -621,23 +1018,68 @@ void checkSleepTimeout() {
 }
 
 void enterDeepSleep() {
+  scroller.stop();
   displayOff();
-  digitalWrite(PIN_LED_CHARGING, LOW);
-  digitalWrite(PIN_LED_ACTIVITY, LOW);
+  renderer.waitIdle(RENDER_IDLE_TIMEOUT_MS);
+  leds.set(LED_CHARGING, 0);
+  leds.set(LED_ACTIVITY, 0);
   
-  uint64_t wakeupMask = 0;
+  // Configuration and screen for the next wake, NVS stays the reference
+  wakeState.midiChannel = midiChannel;
+  memcpy(wakeState.ccNumbers, ccNumbers, sizeof(ccNumbers));
   for (int i = 0; i < 6; i++) {
-    wakeupMask |= (1ULL << buttons[i].pin);
+    wakeState.buttonModes[i] = buttons[i].mode;
   }
-  esp_sleep_enable_ext1_wakeup(wakeupMask, ESP_EXT1_WAKEUP_ANY_HIGH);
+  wakeState.displayMode = currentDisplayMode;
+  wakeManager.saveState(&wakeState, sizeof(wakeState));
   
-  esp_deep_sleep_start();
+  // The ULP watches the active-low footswitches, any press wakes the pedal
+  wakeManager.enterDeepSleep();
+}
+
+void replayWakePress() {
+  // The press that woke the pedal, sent once the host is listening
+  bool linkReady = deviceConnected && pMidiCccd && pMidiCccd->getNotifications();
+  int8_t index = wakeManager.takeWakePress(linkReady);
+  if (index < 0) return;
+  
+  // Stamped with the wake, the host sees when the press happened
+  int64_t wakeUs = wakeManager.getWakeTimeUs();
+  int64_t nowUs = esp_timer_get_time();
+  sendMidiControlChange(midiChannel - 1, ccNumbers[index], 127, wakeUs);
+  flashActivityLED();
+  Serial.printf("Wake press: button %d at %lu ms, sent %lu ms later\n", index + 1,
+                (unsigned long)(wakeUs / 1000), (unsigned long)((nowUs - wakeUs) / 1000));
 }
 
 void loop() {
-  // Handle all buttons
-  for (int i = 0; i < 6; i++) {
-    handleButton(i);
+  bool buttonActive = edgeCapture.hasPending() || isAnyButtonActive();
+  {
+    // Full speed while button events are processed, 80 MHz otherwise
+    PowerLock boost(powerManager, buttonActive);
+    
+    // Drain edges captured by the GPIO ISR, then run debounce and long press
+    // timers on their timestamps
+    ButtonEdge edge;
+    while (edgeCapture.pop(edge)) {
+      handleButtonEdge(edge.button, edge.level, edge.timeUs);
+    }
+    int64_t nowUs = esp_timer_get_time();
+    for (int i = 0; i < 6; i++) {
+      handleButton(i, nowUs);
+    }
+  }
+  
+  replayWakePress();
+  
+  // Wake the MIDI TX task, everything queued this scan goes out as one
+  // notification
+  midiTx.flush();
+  
+  // Messages received from the host since the last pass
+  MidiMessage message;
+  while (midiParser.pop(message)) {
+    handleMidiMessage(message);
   }
   
   // Update battery voltage periodically
@@ -655,34 +1097,63 @@ void loop() {
     } else {
       showBatteryLevel();
     }
-  } else if (currentDisplayMode == MODE_PAIRING) {
-    blinkDisplay();
   } else if (currentDisplayMode == MODE_CHANNEL) {
     // Keep channel displayed
   }
   
-  // Turn off activity LED after duration
-  if (activityLEDOffTime > 0 && millis() > activityLEDOffTime) {
-    digitalWrite(PIN_LED_ACTIVITY, LOW);
-    activityLEDOffTime = 0;
+  // The pairing blink follows the display mode, the BLE callbacks change it too
+  if (currentDisplayMode == MODE_PAIRING) {
+    if (!timeline.isPlaying(pairingBlink) && !timeline.isPlaying(pairingWindow)) {
+      startPairingBlink(pairingBlink, nullptr);
+    }
+  } else {
+    stopPairingBlink();
   }
   
   // Handle BLE connection changes
   if (!deviceConnected && oldDeviceConnected) {
-    delay(500);
-    // Restart advertising pour reconnexion automatique
-    BLEDevice::startAdvertising();
-    Serial.println("Device disconnected - restarting advertising for auto-reconnect");
+    // reconnectManager has already restarted advertising
+    Serial.println("Device disconnected - advertising for auto-reconnect");
     oldDeviceConnected = deviceConnected;
+    powerManager.setConnected(false);
   }
   
   if (deviceConnected && !oldDeviceConnected) {
     Serial.println("Device connected successfully");
     oldDeviceConnected = deviceConnected;
+    powerManager.setConnected(true);
+    
+    // Passer du mode pairing au mode channel, avec le show de lumières
+    // LED jaune 1x par seconde, LED verte 3x par seconde, flashs de 100ms
+    currentDisplayMode = MODE_CHANNEL;
+    stopPairingBlink();
+    updateChannelDisplay();
+    leds.blink(LED_ACTIVITY, 1000, 100, false, 5000);
+    leds.blink(LED_CHARGING, 333, 100, false, 5000);
   }
   
+  // Connection parameter retries and reconnect advertising phases
+  connectionManager.update();
+  txPowerControl.update();
+  reconnectManager.update();
+  
+  // Diagnostics over serial
+  handleSerialCommand();
+  
   // Check for sleep timeout
   checkSleepTimeout();
   
-  delay(10);
+  // Animation keyframes due by now
+  timeline.update(millis());
+  
+  // Text done, back to the screen of the current mode
+  if (scroller.takeFinished()) {
+    writeAnimationOutput(ANIM_MATRIX, Timeline::RELEASE);
+  }
+  
+  // Sleep up to 10ms (longer when connected and idle, shorter when a
+  // keyframe is due), woken early by any footswitch edge
+  uint32_t waitMs = buttonActive || !deviceConnected ? 10 : LOOP_IDLE_WAIT_MS;
+  uint32_t animationMs = timeline.getNextUpdateMs(millis());
+  edgeCapture.waitForEdge(animationMs < waitMs ? animationMs : waitMs);
 }
\ No newline at end of file
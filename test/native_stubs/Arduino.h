@@ -0,0 +1,101 @@
+/*
+ * Native Arduino Shim
+ * The few Arduino, ESP-IDF and FreeRTOS symbols the modules under test use,
+ * so they build unchanged on the host ([env:native])
+ *
+ * Time and GPIO levels are plain variables the tests drive: nativeNowUs()
+ * feeds millis() and esp_timer_get_time(), nativeGpioIn() feeds
+ * digitalRead() and the GPIO input registers.
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+inline int64_t& nativeNowUs() {
+    static int64_t nowUs = 0;
+    return nowUs;
+}
+
+inline uint64_t& nativeGpioIn() {
+    static uint64_t levels = ~0ULL;  // Pull-ups, nothing pressed
+    return levels;
+}
+
+inline unsigned long millis() {
+    return (unsigned long)(nativeNowUs() / 1000);
+}
+
+inline unsigned long micros() {
+    return (unsigned long)nativeNowUs();
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline int digitalRead(uint8_t pin) {
+    return (int)((nativeGpioIn() >> pin) & 0x1);
+}
+
+inline int digitalPinToInterrupt(uint8_t pin) {
+    return pin;
+}
+
+inline void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+
+// FreeRTOS, single task on the host
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR()
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return nullptr;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) {
+    return 0;
+}
+
+class NativeSerial {
+public:
+    size_t printf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n > 0 ? (size_t)n : 0;
+    }
+    size_t print(const char* text) {
+        return (size_t)fputs(text, stdout);
+    }
+    size_t println(const char* text = "") {
+        return (size_t)puts(text);
+    }
+};
+
+static NativeSerial Serial;
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Native BLECharacteristic
+ * Records every notification so tests can decode what went on air
+ *
+ * The notify results Bluedroid would report later (CONF_EVT, congestion)
+ * are left to the test, which calls the module's GATT event handlers.
+ */
+
+#ifndef NATIVE_BLE_CHARACTERISTIC_H
+#define NATIVE_BLE_CHARACTERISTIC_H
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum {
+    ESP_GATT_OK = 0x00,
+    ESP_GATT_ERROR = 0x85,
+    ESP_GATT_CONGESTED = 0x8f
+} esp_gatt_status_t;
+
+class BLECharacteristicCallbacks {
+public:
+    typedef enum {
+        SUCCESS_INDICATE,
+        SUCCESS_NOTIFY,
+        ERROR_INDICATE_DISABLED,
+        ERROR_NOTIFY_DISABLED,
+        ERROR_GATT,
+        ERROR_NO_CLIENT,
+        ERROR_INDICATE_TIMEOUT,
+        ERROR_INDICATE_FAILURE
+    } Status;
+};
+
+class BLECharacteristic {
+public:
+    std::vector<uint8_t> value;
+    std::vector<std::vector<uint8_t> > notified;
+
+    void setValue(uint8_t* data, size_t length) {
+        value.assign(data, data + length);
+    }
+    void notify(bool = true) {
+        notified.push_back(value);
+    }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef NATIVE_DRIVER_GPIO_H
+#define NATIVE_DRIVER_GPIO_H
+
+#include <stdint.h>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+inline int gpio_wakeup_enable(gpio_num_t, gpio_int_type_t) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef NATIVE_GPIO_REG_H
+#define NATIVE_GPIO_REG_H
+
+#include <Arduino.h>
+
+// Register numbers stand for the two GPIO input words
+#define GPIO_IN_REG 0
+#define GPIO_IN1_REG 1
+#define REG_READ(reg) ((uint32_t)(nativeGpioIn() >> ((reg) * 32)))
+
+#endif
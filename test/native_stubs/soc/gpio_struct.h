@@ -0,0 +1,16 @@
+#ifndef NATIVE_GPIO_STRUCT_H
+#define NATIVE_GPIO_STRUCT_H
+
+#include <stdint.h>
+
+struct NativeGpioPin {
+    uint32_t int_type;
+};
+
+struct NativeGpioDev {
+    NativeGpioPin pin[40];
+};
+
+static NativeGpioDev GPIO;
+
+#endif
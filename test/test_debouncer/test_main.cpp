@@ -0,0 +1,283 @@
+/*
+ * Debouncer Equivalence Tests
+ * VerticalDebouncer against Button::update(), fed the same traces
+ *
+ * Each trace gives the raw level of every button at each 10 ms sample.
+ * Button gets an edge (onEdge() stamped at the sample) whenever a level
+ * changes and an update() at every sample, as ButtonManager drives it from
+ * EdgeCapture. The debouncer gets the same sample through processSample().
+ * Both must report the same events on the same sample.
+ */
+
+#include <unity.h>
+#include <vector>
+#include <algorithm>
+
+// Modules under test, built from the sketch and lib/ sources for the host
+#include "../../ESP32_MIDI_Pedal/VerticalDebouncer.cpp"
+#include "../../ESP32_MIDI_Pedal/ButtonManager.cpp"
+#include "../../lib/EdgeCapture/EdgeCapture.cpp"
+
+static const uint8_t TEST_PINS[BUTTON_COUNT] = {
+    PIN_BUTTON_1, PIN_BUTTON_2, PIN_BUTTON_3, PIN_BUTTON_4, PIN_BUTTON_5, PIN_BUTTON_6
+};
+
+struct Segment {
+    uint8_t button;    // 0-based
+    bool pressed;
+    uint16_t samples;  // How long the level holds
+};
+
+struct TraceEvent {
+    uint32_t sample;
+    uint8_t button;    // 1-based, as in ButtonEvent
+    ButtonEventType type;
+
+    bool operator<(const TraceEvent& other) const {
+        if (sample != other.sample) return sample < other.sample;
+        if (button != other.button) return button < other.button;
+        return type < other.type;
+    }
+    bool operator==(const TraceEvent& other) const {
+        return sample == other.sample && button == other.button && type == other.type;
+    }
+};
+
+// Raw levels per sample, bit i = button i pressed
+typedef std::vector<uint8_t> Trace;
+
+static void appendSegment(Trace& trace, std::vector<uint32_t>& cursor, const Segment& segment) {
+    uint32_t start = cursor[segment.button];
+    uint32_t end = start + segment.samples;
+    if (trace.size() < end) trace.resize(end, 0);
+    for (uint32_t k = start; k < end; k++) {
+        if (segment.pressed) {
+            trace[k] |= (1 << segment.button);
+        } else {
+            trace[k] &= ~(1 << segment.button);
+        }
+    }
+    cursor[segment.button] = end;
+}
+
+static Trace buildTrace(const Segment* segments, size_t count) {
+    Trace trace;
+    std::vector<uint32_t> cursor(BUTTON_COUNT, 0);
+    for (size_t i = 0; i < count; i++) {
+        appendSegment(trace, cursor, segments[i]);
+    }
+    // Everything released long enough for the last event to come out
+    trace.resize(trace.size() + 200, 0);
+    return trace;
+}
+
+static std::vector<TraceEvent> runButtons(const Trace& trace) {
+    std::vector<TraceEvent> events;
+    Button buttons[BUTTON_COUNT];
+    ButtonEventQueue queue;
+    uint8_t previous = 0;
+
+    nativeGpioIn() = ~0ULL;
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        buttons[i].init(TEST_PINS[i], i + 1);
+    }
+
+    for (uint32_t k = 0; k < trace.size(); k++) {
+        int64_t nowUs = (int64_t)k * BUTTON_SAMPLE_PERIOD * 1000;
+        for (int i = 0; i < BUTTON_COUNT; i++) {
+            bool pressed = (trace[k] >> i) & 0x1;
+            if (pressed != (bool)((previous >> i) & 0x1)) {
+                buttons[i].onEdge(pressed ? LOW : HIGH, nowUs, queue);
+            }
+            buttons[i].update(nowUs, queue);
+        }
+        previous = trace[k];
+
+        ButtonEvent event;
+        while (queue.pop(event)) {
+            TraceEvent traced = {k, event.buttonNumber, event.type};
+            events.push_back(traced);
+        }
+    }
+    std::sort(events.begin(), events.end());
+    return events;
+}
+
+static void takeMask(std::vector<TraceEvent>& events, uint32_t sample, uint32_t mask, ButtonEventType type) {
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        if ((mask >> i) & 0x1) {
+            TraceEvent traced = {sample, (uint8_t)(i + 1), type};
+            events.push_back(traced);
+        }
+    }
+}
+
+static std::vector<TraceEvent> runDebouncer(const Trace& trace) {
+    std::vector<TraceEvent> events;
+    VerticalDebouncer debouncer;
+
+    nativeGpioIn() = ~0ULL;
+    debouncer.begin(TEST_PINS, BUTTON_COUNT, BUTTON_SAMPLE_PERIOD, DEBOUNCE_DELAY, LONG_PRESS_TIME);
+
+    for (uint32_t k = 0; k < trace.size(); k++) {
+        uint64_t active = 0;
+        for (int i = 0; i < BUTTON_COUNT; i++) {
+            if ((trace[k] >> i) & 0x1) {
+                active |= 1ULL << TEST_PINS[i];
+            }
+        }
+        debouncer.processSample(active);
+
+        takeMask(events, k, debouncer.takePressed(), BUTTON_PRESS);
+        takeMask(events, k, debouncer.takeLongPressed(), BUTTON_LONG_PRESS);
+        takeMask(events, k, debouncer.takeReleased(), BUTTON_RELEASE);
+    }
+    std::sort(events.begin(), events.end());
+    return events;
+}
+
+static void assertSameEvents(const Segment* segments, size_t count, size_t expectedEvents) {
+    Trace trace = buildTrace(segments, count);
+    std::vector<TraceEvent> expected = runButtons(trace);
+    std::vector<TraceEvent> actual = runDebouncer(trace);
+
+    TEST_ASSERT_EQUAL_MESSAGE(expectedEvents, expected.size(), "Button::update() event count");
+    TEST_ASSERT_EQUAL_MESSAGE(expected.size(), actual.size(), "VerticalDebouncer event count");
+    for (size_t i = 0; i < expected.size(); i++) {
+        char message[96];
+        snprintf(message, sizeof(message), "event %u: sample %u button %u type %d",
+                 (unsigned)i, (unsigned)expected[i].sample, expected[i].button, expected[i].type);
+        TEST_ASSERT_TRUE_MESSAGE(expected[i] == actual[i], message);
+    }
+}
+
+void setUp() {
+    nativeNowUs() = 0;
+    nativeGpioIn() = ~0ULL;
+}
+
+void tearDown() {
+}
+
+void test_clean_press() {
+    const Segment segments[] = {
+        {0, false, 5}, {0, true, 30}, {0, false, 1}
+    };
+    assertSameEvents(segments, 3, 2);
+}
+
+void test_glitch_shorter_than_debounce() {
+    const Segment segments[] = {
+        {0, false, 5}, {0, true, 3}, {0, false, 10}, {0, true, 5}, {0, false, 1}
+    };
+    assertSameEvents(segments, 5, 0);
+}
+
+void test_press_and_release_bounce() {
+    const Segment segments[] = {
+        {2, false, 7},
+        {2, true, 1}, {2, false, 1}, {2, true, 2}, {2, false, 1}, {2, true, 40},
+        {2, false, 1}, {2, true, 1}, {2, false, 2}, {2, true, 1}, {2, false, 1}
+    };
+    assertSameEvents(segments, 11, 2);
+}
+
+void test_level_held_exactly_to_the_settle_sample() {
+    // The release edge lands on the sample where the press settles,
+    // onEdge() resolves the press before taking the edge
+    const Segment segments[] = {
+        {1, false, 3}, {1, true, DEBOUNCE_DELAY / BUTTON_SAMPLE_PERIOD + 1}, {1, false, 20},
+        {1, true, DEBOUNCE_DELAY / BUTTON_SAMPLE_PERIOD}, {1, false, 1}
+    };
+    assertSameEvents(segments, 5, 2);
+}
+
+void test_long_press() {
+    const Segment segments[] = {
+        {4, false, 2}, {4, true, 150}, {4, false, 1}
+    };
+    assertSameEvents(segments, 3, 2);  // Press and long press, no release
+}
+
+void test_long_press_after_bounced_press() {
+    const Segment segments[] = {
+        {5, false, 2}, {5, true, 1}, {5, false, 2}, {5, true, 1}, {5, false, 1}, {5, true, 140},
+        {5, false, 1}
+    };
+    assertSameEvents(segments, 7, 2);
+}
+
+void test_glitch_across_long_press_deadline() {
+    // Open for a few samples right when the long press is due
+    uint16_t due = LONG_PRESS_TIME / BUTTON_SAMPLE_PERIOD;
+    const Segment segments[] = {
+        {0, false, 4}, {0, true, (uint16_t)(due - 1)}, {0, false, 3}, {0, true, 50}, {0, false, 1}
+    };
+    assertSameEvents(segments, 5, 2);
+}
+
+void test_release_just_before_long_press() {
+    uint16_t due = LONG_PRESS_TIME / BUTTON_SAMPLE_PERIOD;
+    const Segment segments[] = {
+        {3, false, 4}, {3, true, (uint16_t)(due - 1)}, {3, false, 1}
+    };
+    assertSameEvents(segments, 3, 2);
+}
+
+void test_hold_across_long_release() {
+    // Open longer than the debounce delay: release, then a new press
+    const Segment segments[] = {
+        {0, false, 4}, {0, true, 60}, {0, false, 8}, {0, true, 120}, {0, false, 1}
+    };
+    assertSameEvents(segments, 5, 4);
+}
+
+void test_buttons_interleaved() {
+    const Segment segments[] = {
+        {0, false, 3}, {0, true, 30}, {0, false, 1},
+        {1, false, 10}, {1, true, 1}, {1, false, 1}, {1, true, 120}, {1, false, 1},
+        {4, false, 20}, {4, true, 2}, {4, false, 2}, {4, true, 101}, {4, false, 1},
+        {5, false, 20}, {5, true, 101}, {5, false, 1}
+    };
+    assertSameEvents(segments, 16, 8);
+}
+
+void test_random_traces() {
+    // Bouncy switches: short flickers and holds of every length up to 1.5 s
+    uint32_t seed = 0x1234567;
+    for (int run = 0; run < 200; run++) {
+        std::vector<Segment> segments;
+        for (int i = 0; i < BUTTON_COUNT; i++) {
+            bool pressed = false;
+            for (int n = 0; n < 30; n++) {
+                seed = seed * 1103515245 + 12345;
+                uint16_t samples = (seed >> 16) % 4 == 0 ? 1 + (seed >> 8) % 150 : 1 + (seed >> 8) % 8;
+                Segment segment = {(uint8_t)i, pressed, samples};
+                segments.push_back(segment);
+                pressed = !pressed;
+            }
+        }
+
+        Trace trace = buildTrace(segments.data(), segments.size());
+        std::vector<TraceEvent> expected = runButtons(trace);
+        std::vector<TraceEvent> actual = runDebouncer(trace);
+        TEST_ASSERT_EQUAL(expected.size(), actual.size());
+        TEST_ASSERT_TRUE(std::equal(expected.begin(), expected.end(), actual.begin()));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_press);
+    RUN_TEST(test_glitch_shorter_than_debounce);
+    RUN_TEST(test_press_and_release_bounce);
+    RUN_TEST(test_level_held_exactly_to_the_settle_sample);
+    RUN_TEST(test_long_press);
+    RUN_TEST(test_long_press_after_bounced_press);
+    RUN_TEST(test_glitch_across_long_press_deadline);
+    RUN_TEST(test_release_just_before_long_press);
+    RUN_TEST(test_hold_across_long_release);
+    RUN_TEST(test_buttons_interleaved);
+    RUN_TEST(test_random_traces);
+    return UNITY_END();
+}
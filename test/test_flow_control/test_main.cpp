@@ -0,0 +1,177 @@
+/*
+ * MIDI Flow Control Tests
+ * Backlog drop policy when the backlog is full
+ *
+ * The backlog is filled while nothing is confirmed, then drained packet by
+ * packet through the native BLECharacteristic. Each packet is decoded with
+ * MidiParser, so the checks see the messages a receiver would get.
+ */
+
+#include <unity.h>
+#include <vector>
+
+// Modules under test, built from the lib/ sources for the host
+#include "../../lib/MidiPacketBuilder/MidiPacketBuilder.cpp"
+#include "../../lib/MidiFlowControl/MidiFlowControl.cpp"
+#include "../../lib/MidiParser/MidiParser.cpp"
+
+static BLECharacteristic characteristic;
+static MidiFlowControl* flowControl;
+static MidiParser parser;
+
+static MidiTxEvent makeEvent(uint8_t status, uint8_t data1, uint8_t data2, bool continuous) {
+    MidiTxEvent event;
+    event.data[0] = status;
+    event.data[1] = data1;
+    event.data[2] = data2;
+    event.length = 3;
+    event.continuous = continuous;
+    event.timestamp = MidiPacketBuilder::timestampFromMicros(nativeNowUs());
+    event.sourceUs = 0;
+    event.enqueueUs = nativeNowUs();
+    return event;
+}
+
+static MidiTxEvent noteOn(uint8_t note) {
+    return makeEvent(0x90, note, 100, false);
+}
+
+static MidiTxEvent controlValue(uint8_t control, uint8_t value) {
+    return makeEvent(0xB0, control, value, true);
+}
+
+static void fill(uint8_t switches, const uint8_t* controls, uint8_t controlCount) {
+    for (uint8_t i = 0; i < switches; i++) {
+        TEST_ASSERT_TRUE(flowControl->push(noteOn(i)));
+    }
+    for (uint8_t i = 0; i < controlCount; i++) {
+        TEST_ASSERT_TRUE(flowControl->push(controlValue(controls[i], 1)));
+    }
+    TEST_ASSERT_EQUAL_UINT8(MidiFlowControl::BACKLOG_SIZE, flowControl->getBacklog());
+}
+
+// Sends and confirms everything, returns the decoded messages in order
+static std::vector<MidiMessage> drain() {
+    std::vector<MidiMessage> messages;
+    for (int i = 0; i < 100 && !flowControl->isIdle(); i++) {
+        nativeNowUs() += 10000;
+        flowControl->onNotifyResult(ESP_GATT_OK);
+        flowControl->update(nativeNowUs());
+        flowControl->sendBacklog(nativeNowUs());
+    }
+    TEST_ASSERT_TRUE(flowControl->isIdle());
+
+    for (size_t i = 0; i < characteristic.notified.size(); i++) {
+        const std::vector<uint8_t>& bytes = characteristic.notified[i];
+        parser.parse(bytes.data(), bytes.size());
+        MidiMessage message;
+        while (parser.pop(message)) {
+            messages.push_back(message);
+        }
+    }
+    return messages;
+}
+
+static int countControl(const std::vector<MidiMessage>& messages, uint8_t control, int value) {
+    int count = 0;
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (messages[i].status == 0xB0 && messages[i].data1 == control &&
+            (value < 0 || messages[i].data2 == value)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static int countSwitches(const std::vector<MidiMessage>& messages) {
+    int count = 0;
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (messages[i].status == 0x90) count++;
+    }
+    return count;
+}
+
+void setUp() {
+    nativeNowUs() = 1000000;
+    characteristic.notified.clear();
+    parser.reset();
+    flowControl = new MidiFlowControl();
+    flowControl->begin(&characteristic);
+}
+
+void tearDown() {
+    delete flowControl;
+}
+
+void test_full_replaces_same_controller_across_switches() {
+    // CC 7 sits behind switch events, so only the full path reaches it
+    const uint8_t controls[] = {7, 8};
+    fill(MidiFlowControl::BACKLOG_SIZE - 2, controls, 2);
+    TEST_ASSERT_FALSE(flowControl->push(noteOn(100)));
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(7, 99)));
+    TEST_ASSERT_EQUAL_UINT8(MidiFlowControl::BACKLOG_SIZE, flowControl->getBacklog());
+
+    std::vector<MidiMessage> messages = drain();
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 7, -1));
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 7, 99));
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 8, 1));
+    TEST_ASSERT_EQUAL_INT(MidiFlowControl::BACKLOG_SIZE - 2, countSwitches(messages));
+}
+
+void test_full_takes_the_newest_continuous_entry() {
+    // No CC 9 queued: the new value takes the place of CC 8, the newest
+    const uint8_t controls[] = {7, 8};
+    fill(MidiFlowControl::BACKLOG_SIZE - 2, controls, 2);
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(9, 42)));
+    TEST_ASSERT_EQUAL_UINT8(MidiFlowControl::BACKLOG_SIZE, flowControl->getBacklog());
+
+    std::vector<MidiMessage> messages = drain();
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 9, 42));
+    TEST_ASSERT_EQUAL_INT(0, countControl(messages, 8, -1));
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 7, 1));
+    TEST_ASSERT_EQUAL_INT(MidiFlowControl::BACKLOG_SIZE - 2, countSwitches(messages));
+}
+
+void test_full_of_switches_drops_the_value() {
+    fill(MidiFlowControl::BACKLOG_SIZE, nullptr, 0);
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(7, 5)));
+    TEST_ASSERT_FALSE(flowControl->push(noteOn(100)));
+
+    std::vector<MidiMessage> messages = drain();
+    TEST_ASSERT_EQUAL_INT(0, countControl(messages, 7, -1));
+    TEST_ASSERT_EQUAL_INT(MidiFlowControl::BACKLOG_SIZE, countSwitches(messages));
+}
+
+void test_switch_events_keep_their_order() {
+    fill(MidiFlowControl::BACKLOG_SIZE, nullptr, 0);
+    std::vector<MidiMessage> messages = drain();
+    TEST_ASSERT_EQUAL_size_t(MidiFlowControl::BACKLOG_SIZE, messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT8(i, messages[i].data1);
+    }
+}
+
+void test_not_full_supersedes_only_behind_switches() {
+    // A switch between the two values keeps both, they are not merged
+    // across it
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(7, 1)));
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(7, 2)));
+    TEST_ASSERT_TRUE(flowControl->push(noteOn(1)));
+    TEST_ASSERT_TRUE(flowControl->push(controlValue(7, 3)));
+    TEST_ASSERT_EQUAL_UINT8(3, flowControl->getBacklog());
+
+    std::vector<MidiMessage> messages = drain();
+    TEST_ASSERT_EQUAL_INT(0, countControl(messages, 7, 1));
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 7, 2));
+    TEST_ASSERT_EQUAL_INT(1, countControl(messages, 7, 3));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_replaces_same_controller_across_switches);
+    RUN_TEST(test_full_takes_the_newest_continuous_entry);
+    RUN_TEST(test_full_of_switches_drops_the_value);
+    RUN_TEST(test_switch_events_keep_their_order);
+    RUN_TEST(test_not_full_supersedes_only_behind_switches);
+    return UNITY_END();
+}
@@ -0,0 +1,256 @@
+/*
+ * MIDI Handler SysEx Tests
+ * Packet layouts, refused sends, invalid data bytes and cancel
+ *
+ * The handler streams into the native BLECharacteristic, which records
+ * every notification. Each packet is confirmed with onNotifyResult() the
+ * way Bluedroid's CONF_EVT would, and the default 20-byte packet size is
+ * used so a short message already spans several packets.
+ */
+
+#include <unity.h>
+
+// Modules under test, built from the sketch and lib/ sources for the host
+#include "../../lib/MidiPacketBuilder/MidiPacketBuilder.cpp"
+#include "../../lib/MidiFlowControl/MidiFlowControl.cpp"
+#include "../../ESP32_MIDI_Pedal/MidiHandler.cpp"
+
+static const size_t PACKET_SIZE = 20;
+static const size_t FIRST_ROOM = PACKET_SIZE - 5;         // header, timestamp, F0 + end marker
+static const size_t CONTINUATION_ROOM = PACKET_SIZE - 3;  // header + end marker
+
+static BLECharacteristic characteristic;
+static MidiHandler* handler;
+static uint8_t payload[256];
+
+struct StreamSource {
+    const uint8_t* data;
+    size_t remaining;
+    int calls;
+    bool congestOnFirstCall;
+};
+
+static size_t readStream(uint8_t* dest, size_t maxLength, void* context) {
+    StreamSource* source = (StreamSource*)context;
+    size_t count = source->remaining < maxLength ? source->remaining : maxLength;
+    memcpy(dest, source->data, count);
+    source->data += count;
+    source->remaining -= count;
+    // The BLE task reporting congestion while loop() builds the packet
+    if (source->congestOnFirstCall && source->calls == 0) {
+        handler->onCongestion(true);
+    }
+    source->calls++;
+    return count;
+}
+
+// One loop pass: the previous packet is confirmed, then flush() runs
+static void pass() {
+    nativeNowUs() += 10000;
+    handler->onNotifyResult(ESP_GATT_OK);
+    handler->flush();
+}
+
+static void drain() {
+    for (int i = 0; i < 100 && !handler->isIdle(); i++) {
+        pass();
+    }
+    TEST_ASSERT_TRUE(handler->isIdle());
+}
+
+static const std::vector<uint8_t>& packet(size_t index) {
+    TEST_ASSERT_TRUE(index < characteristic.notified.size());
+    return characteristic.notified[index];
+}
+
+static void assertData(const std::vector<uint8_t>& bytes, size_t offset, size_t payloadOffset, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_HEX8(payload[payloadOffset + i], bytes[offset + i]);
+    }
+}
+
+static void assertStart(const std::vector<uint8_t>& bytes) {
+    TEST_ASSERT_EQUAL_HEX8(0x80, bytes[0] & 0xC0);  // Header
+    TEST_ASSERT_EQUAL_HEX8(0x80, bytes[1] & 0x80);  // Timestamp
+    TEST_ASSERT_EQUAL_HEX8(0xF0, bytes[2]);
+}
+
+static void assertEnd(const std::vector<uint8_t>& bytes) {
+    size_t length = bytes.size();
+    TEST_ASSERT_TRUE(length >= 3);
+    TEST_ASSERT_EQUAL_HEX8(0x80, bytes[length - 2] & 0x80);
+    TEST_ASSERT_EQUAL_HEX8(0xF7, bytes[length - 1]);
+}
+
+void setUp() {
+    nativeNowUs() = 1000000;
+    characteristic.notified.clear();
+    handler = new MidiHandler();
+    handler->begin(&characteristic);
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)(i * 7) & 0x7F;
+    }
+}
+
+void tearDown() {
+    delete handler;
+}
+
+void test_single_packet() {
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, 10));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(1, characteristic.notified.size());
+    const std::vector<uint8_t>& bytes = packet(0);
+    TEST_ASSERT_EQUAL_size_t(3 + 10 + 2, bytes.size());
+    assertStart(bytes);
+    assertData(bytes, 3, 0, 10);
+    assertEnd(bytes);
+}
+
+void test_start_continuation_end() {
+    size_t length = FIRST_ROOM + CONTINUATION_ROOM + 8;
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, length));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(3, characteristic.notified.size());
+
+    // First: header, timestamp, F0, data
+    const std::vector<uint8_t>& first = packet(0);
+    TEST_ASSERT_EQUAL_size_t(3 + FIRST_ROOM, first.size());
+    assertStart(first);
+    assertData(first, 3, 0, FIRST_ROOM);
+
+    // Continuation: header, data only
+    const std::vector<uint8_t>& middle = packet(1);
+    TEST_ASSERT_EQUAL_size_t(1 + CONTINUATION_ROOM, middle.size());
+    TEST_ASSERT_EQUAL_HEX8(0x80, middle[0] & 0xC0);
+    assertData(middle, 1, FIRST_ROOM, CONTINUATION_ROOM);
+
+    // Last: header, data, timestamp, F7
+    const std::vector<uint8_t>& last = packet(2);
+    TEST_ASSERT_EQUAL_size_t(1 + 8 + 2, last.size());
+    assertData(last, 1, FIRST_ROOM + CONTINUATION_ROOM, 8);
+    assertEnd(last);
+}
+
+void test_framing_bytes_accepted() {
+    uint8_t framed[12];
+    framed[0] = 0xF0;
+    memcpy(&framed[1], payload, 10);
+    framed[11] = 0xF7;
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(framed, sizeof(framed)));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(1, characteristic.notified.size());
+    TEST_ASSERT_EQUAL_size_t(3 + 10 + 2, packet(0).size());
+    assertData(packet(0), 3, 0, 10);
+}
+
+void test_payload_filling_the_packet_exactly() {
+    // The source fills the first packet, the end marker goes out alone
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, FIRST_ROOM));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(2, characteristic.notified.size());
+    TEST_ASSERT_EQUAL_size_t(3 + FIRST_ROOM, packet(0).size());
+    TEST_ASSERT_EQUAL_size_t(3, packet(1).size());
+    assertEnd(packet(1));
+}
+
+void test_status_byte_in_buffer_rejected() {
+    payload[4] = 0x90;
+    TEST_ASSERT_FALSE(handler->sendSystemExclusive(payload, 10));
+    TEST_ASSERT_FALSE(handler->isSysExBusy());
+    drain();
+    TEST_ASSERT_EQUAL_size_t(0, characteristic.notified.size());
+}
+
+void test_status_byte_from_source_aborts() {
+    // The bad byte sits in the second packet: the bytes before it go out
+    // and the message is closed there
+    size_t bad = FIRST_ROOM + 5;
+    payload[bad] = 0x90;
+    StreamSource source = {payload, 100, 0, false};
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(readStream, &source));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(2, characteristic.notified.size());
+    assertStart(packet(0));
+    const std::vector<uint8_t>& last = packet(1);
+    TEST_ASSERT_EQUAL_size_t(1 + 5 + 2, last.size());
+    assertData(last, 1, FIRST_ROOM, 5);
+    assertEnd(last);
+    TEST_ASSERT_FALSE(handler->isSysExBusy());
+    TEST_ASSERT_EQUAL_INT(2, source.calls);
+}
+
+void test_refused_packet_kept_for_retry() {
+    // Congestion lands between canSend() and send(): nothing goes out and
+    // the source is not read again for the same packet
+    StreamSource source = {payload, 30, 0, true};
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(readStream, &source));
+    pass();
+    TEST_ASSERT_EQUAL_size_t(0, characteristic.notified.size());
+    TEST_ASSERT_EQUAL_INT(1, source.calls);
+
+    handler->onCongestion(false);
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(2, characteristic.notified.size());
+    const std::vector<uint8_t>& first = packet(0);
+    assertStart(first);
+    TEST_ASSERT_EQUAL_size_t(3 + FIRST_ROOM, first.size());
+    assertData(first, 3, 0, FIRST_ROOM);
+    const std::vector<uint8_t>& last = packet(1);
+    TEST_ASSERT_EQUAL_size_t(1 + 30 - FIRST_ROOM + 2, last.size());
+    assertData(last, 1, FIRST_ROOM, 30 - FIRST_ROOM);
+    assertEnd(last);
+}
+
+void test_cancel_applies_on_the_loop_task() {
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, 200));
+    pass();
+    size_t sent = characteristic.notified.size();
+    TEST_ASSERT_TRUE(sent > 0);
+
+    // From the BLE task: the state stays as is until the loop runs
+    handler->onDisconnect();
+    TEST_ASSERT_TRUE(handler->isSysExBusy());
+
+    pass();
+    TEST_ASSERT_FALSE(handler->isSysExBusy());
+    drain();
+    TEST_ASSERT_EQUAL_size_t(sent, characteristic.notified.size());
+}
+
+void test_new_message_after_cancel() {
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, 200));
+    pass();
+    handler->cancelSystemExclusive();
+
+    // The pending cancel is taken first, it does not hit the new message
+    size_t sent = characteristic.notified.size();
+    TEST_ASSERT_TRUE(handler->sendSystemExclusive(payload, 10));
+    drain();
+
+    TEST_ASSERT_EQUAL_size_t(sent + 1, characteristic.notified.size());
+    const std::vector<uint8_t>& bytes = packet(sent);
+    TEST_ASSERT_EQUAL_size_t(3 + 10 + 2, bytes.size());
+    assertStart(bytes);
+    assertEnd(bytes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_packet);
+    RUN_TEST(test_start_continuation_end);
+    RUN_TEST(test_framing_bytes_accepted);
+    RUN_TEST(test_payload_filling_the_packet_exactly);
+    RUN_TEST(test_status_byte_in_buffer_rejected);
+    RUN_TEST(test_status_byte_from_source_aborts);
+    RUN_TEST(test_refused_packet_kept_for_retry);
+    RUN_TEST(test_cancel_applies_on_the_loop_task);
+    RUN_TEST(test_new_message_after_cancel);
+    return UNITY_END();
+}
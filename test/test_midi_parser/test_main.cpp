@@ -0,0 +1,370 @@
+/*
+ * MIDI Parser Tests
+ * BLE-MIDI packets as a host may write them, well-formed or not
+ *
+ * Covers headers, timestamp wrap, running status, SysEx spread over several
+ * packets, a full ring, and truncated or random packets that must never
+ * produce a malformed message. test_benchmark prints the decode rate.
+ */
+
+#include <unity.h>
+#include <chrono>
+
+// Module under test, built from the shared library for the host
+#include "../../lib/MidiParser/MidiParser.cpp"
+
+static MidiParser parser;
+
+static uint8_t header(uint16_t timestamp) {
+    return 0x80 | ((timestamp >> 7) & 0x3F);
+}
+
+static uint8_t stamp(uint16_t timestamp) {
+    return 0x80 | (timestamp & 0x7F);
+}
+
+static void assertMessage(uint8_t status, uint8_t data1, uint8_t data2, uint8_t length,
+                          uint16_t timestamp) {
+    MidiMessage message;
+    TEST_ASSERT_TRUE(parser.pop(message));
+    TEST_ASSERT_EQUAL_HEX8(status, message.status);
+    TEST_ASSERT_EQUAL_UINT8(data1, message.data1);
+    TEST_ASSERT_EQUAL_UINT8(data2, message.data2);
+    TEST_ASSERT_EQUAL_UINT8(length, message.length);
+    TEST_ASSERT_EQUAL_UINT16(timestamp, message.timestamp);
+}
+
+static void assertWellFormed(const MidiMessage& message) {
+    TEST_ASSERT_TRUE(message.status & 0x80);
+    TEST_ASSERT_TRUE(message.timestamp <= 0x1FFF);
+    TEST_ASSERT_TRUE(message.data1 < 0x80);
+    TEST_ASSERT_TRUE(message.data2 < 0x80);
+    if (message.status == 0xF0) {
+        TEST_ASSERT_EQUAL_UINT8(0, message.length);
+    } else {
+        TEST_ASSERT_TRUE(message.length >= 1 && message.length <= 3);
+    }
+}
+
+// Host-side stand-in for the loop task
+static size_t drain() {
+    size_t count = 0;
+    MidiMessage message;
+    while (parser.pop(message)) {
+        assertWellFormed(message);
+        count++;
+    }
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_TRUE(parser.readSysEx(sysex, sizeof(sysex)) <= MidiParser::SYSEX_BUFFER_SIZE);
+    return count;
+}
+
+void setUp() {
+    parser.reset();
+    drain();
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    parser.readSysEx(sysex, sizeof(sysex));
+}
+
+void tearDown() {
+}
+
+void test_single_message() {
+    const uint8_t packet[] = {header(1000), stamp(1000), 0xB0, 7, 100};
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0xB0, 7, 100, 3, 1000);
+    MidiMessage message;
+    TEST_ASSERT_FALSE(parser.pop(message));
+}
+
+void test_bad_headers() {
+    uint32_t invalid = parser.getInvalidCount();
+    const uint8_t noHeaderBit[] = {0x00, stamp(0), 0x90, 60, 100};
+    const uint8_t timestampBit[] = {0xC0, stamp(0), 0x90, 60, 100};
+    const uint8_t dataAfterHeader[] = {header(0), 60, 100};
+    const uint8_t headerOnly[] = {header(0)};
+
+    parser.parse(noHeaderBit, sizeof(noHeaderBit));
+    parser.parse(timestampBit, sizeof(timestampBit));
+    parser.parse(dataAfterHeader, sizeof(dataAfterHeader));
+    parser.parse(headerOnly, sizeof(headerOnly));
+    parser.parse(headerOnly, 0);
+
+    TEST_ASSERT_EQUAL_size_t(0, drain());
+    TEST_ASSERT_EQUAL_UINT32(invalid + 5, parser.getInvalidCount());
+}
+
+void test_truncated_packets() {
+    // Every prefix of a valid packet decodes to a prefix of its messages
+    const uint8_t packet[] = {
+        header(200), stamp(200), 0x90, 60, 100, stamp(201), 0xF8, 61, 101,
+        stamp(202), 0xC0, 5, stamp(203), 0x80, 60, 0
+    };
+    const MidiMessage expected[] = {
+        {200, 0x90, 60, 100, 3}, {201, 0xF8, 0, 0, 1}, {201, 0x90, 61, 101, 3},
+        {202, 0xC0, 5, 0, 2}, {203, 0x80, 60, 0, 3}
+    };
+
+    for (size_t length = 0; length <= sizeof(packet); length++) {
+        parser.reset();
+        parser.parse(packet, length);
+
+        size_t count = 0;
+        MidiMessage message;
+        while (parser.pop(message)) {
+            TEST_ASSERT_TRUE(count < sizeof(expected) / sizeof(expected[0]));
+            TEST_ASSERT_EQUAL_HEX8(expected[count].status, message.status);
+            TEST_ASSERT_EQUAL_UINT8(expected[count].data1, message.data1);
+            TEST_ASSERT_EQUAL_UINT8(expected[count].data2, message.data2);
+            TEST_ASSERT_EQUAL_UINT16(expected[count].timestamp, message.timestamp);
+            count++;
+        }
+        if (length == sizeof(packet)) {
+            TEST_ASSERT_EQUAL_size_t(5, count);
+        }
+    }
+}
+
+void test_random_packets() {
+    // Nothing a host writes may crash the decoder or leave a malformed message
+    uint32_t packets = parser.getPacketCount();
+    uint32_t seed = 0xC0FFEE;
+    uint8_t packet[64];
+    for (int run = 0; run < 20000; run++) {
+        seed = seed * 1103515245 + 12345;
+        size_t length = (seed >> 16) % sizeof(packet);
+        for (size_t i = 0; i < length; i++) {
+            seed = seed * 1103515245 + 12345;
+            packet[i] = seed >> 16;
+        }
+        // Half of them with a valid header, to get past the first check
+        if (length > 0 && (run & 1)) {
+            packet[0] = 0x80 | (packet[0] & 0x3F);
+        }
+        parser.parse(packet, length);
+        if ((run % 7) == 0) {
+            drain();
+        }
+    }
+    drain();
+    TEST_ASSERT_EQUAL_UINT32(packets + 20000, parser.getPacketCount());
+}
+
+void test_timestamp_low_byte_wrap() {
+    // The low byte going backwards inside a packet advances the high bits
+    const uint8_t packet[] = {
+        header(0x2FE), stamp(0x2FE), 0x90, 60, 100, stamp(0x302), 0x80, 60, 0
+    };
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0x90, 60, 100, 3, 0x2FE);
+    assertMessage(0x80, 60, 0, 3, 0x302);
+}
+
+void test_timestamp_13_bit_wrap() {
+    // 8191 ms then 1 ms: the high bits wrap from 0x3F to 0
+    const uint8_t packet[] = {
+        header(0x1FFF), stamp(0x1FFF), 0xB0, 1, 1, stamp(0x0001), 0xB0, 1, 2
+    };
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0xB0, 1, 1, 3, 0x1FFF);
+    assertMessage(0xB0, 1, 2, 3, 0x0001);
+}
+
+void test_timestamp_wrap_is_per_packet() {
+    // A lower low byte at the start of the next packet is not a wrap, the
+    // header carries the high bits again
+    const uint8_t first[] = {header(0x10), stamp(0x7F), 0x90, 60, 100};
+    const uint8_t second[] = {header(0x10), stamp(0x05), 0x80, 60, 0};
+    parser.parse(first, sizeof(first));
+    parser.parse(second, sizeof(second));
+    assertMessage(0x90, 60, 100, 3, 0x7F);
+    assertMessage(0x80, 60, 0, 3, 0x05);
+}
+
+void test_running_status() {
+    // Without a timestamp, with one, and across a real-time message
+    const uint8_t packet[] = {
+        header(500), stamp(500), 0xB0, 7, 10, 7, 11,
+        stamp(502), 7, 12,
+        stamp(503), 0xFE, stamp(504), 7, 13
+    };
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0xB0, 7, 10, 3, 500);
+    assertMessage(0xB0, 7, 11, 3, 500);
+    assertMessage(0xB0, 7, 12, 3, 502);
+    assertMessage(0xFE, 0, 0, 1, 503);
+    assertMessage(0xB0, 7, 13, 3, 504);
+}
+
+void test_running_status_cleared_by_system_common() {
+    uint32_t invalid = parser.getInvalidCount();
+    const uint8_t packet[] = {
+        header(0), stamp(0), 0x90, 60, 100, stamp(1), 0xF3, 4, stamp(2), 61, 101
+    };
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0x90, 60, 100, 3, 0);
+    assertMessage(0xF3, 4, 0, 2, 1);
+    TEST_ASSERT_EQUAL_size_t(0, drain());
+    TEST_ASSERT_EQUAL_UINT32(invalid + 2, parser.getInvalidCount());
+}
+
+static void sendSysEx(size_t total, uint8_t firstValue) {
+    // Spread over 20-byte packets: F0 in the first, F7 in the last
+    size_t sent = 0;
+    bool first = true;
+    while (first || sent < total) {
+        uint8_t packet[20];
+        size_t length = 0;
+        packet[length++] = header(0);
+        if (first) {
+            packet[length++] = stamp(0);
+            packet[length++] = 0xF0;
+            first = false;
+        }
+        while (sent < total && length < sizeof(packet) - 2) {
+            packet[length++] = (uint8_t)((firstValue + sent++) & 0x7F);
+        }
+        if (sent == total) {
+            packet[length++] = stamp(1);
+            packet[length++] = 0xF7;
+        }
+        parser.parse(packet, length);
+    }
+}
+
+void test_sysex_multi_packet() {
+    sendSysEx(100, 3);
+    assertMessage(0xF0, 0, 0, 0, 1);
+
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_size_t(100, parser.readSysEx(sysex, sizeof(sysex)));
+    for (size_t i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_UINT8((3 + i) & 0x7F, sysex[i]);
+    }
+}
+
+void test_sysex_exactly_fills_buffer() {
+    sendSysEx(MidiParser::SYSEX_BUFFER_SIZE, 0);
+    assertMessage(0xF0, 0, 0, 0, 1);
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_size_t(MidiParser::SYSEX_BUFFER_SIZE, parser.readSysEx(sysex, sizeof(sysex)));
+}
+
+void test_sysex_overflow() {
+    // Past the 128-byte buffer the SysEx is dropped whole, the next one is fine
+    uint32_t overflows = parser.getOverflowCount();
+    sendSysEx(MidiParser::SYSEX_BUFFER_SIZE + 1, 0);
+    sendSysEx(300, 0);
+    TEST_ASSERT_EQUAL_size_t(0, drain());
+    TEST_ASSERT_EQUAL_UINT32(overflows + 2, parser.getOverflowCount());
+
+    sendSysEx(10, 40);
+    assertMessage(0xF0, 0, 0, 0, 1);
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_size_t(10, parser.readSysEx(sysex, sizeof(sysex)));
+    TEST_ASSERT_EQUAL_UINT8(40, sysex[0]);
+}
+
+void test_sysex_waits_for_consumer() {
+    // A second SysEx before the first is read is dropped
+    uint32_t overflows = parser.getOverflowCount();
+    sendSysEx(8, 1);
+    sendSysEx(8, 50);
+    TEST_ASSERT_EQUAL_UINT32(overflows + 1, parser.getOverflowCount());
+
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_size_t(8, parser.readSysEx(sysex, sizeof(sysex)));
+    TEST_ASSERT_EQUAL_UINT8(1, sysex[0]);
+    TEST_ASSERT_EQUAL_size_t(0, parser.readSysEx(sysex, sizeof(sysex)));
+}
+
+void test_realtime_inside_sysex() {
+    const uint8_t packet[] = {
+        header(10), stamp(10), 0xF0, 1, 2, stamp(11), 0xF8, 3, stamp(12), 0xF7
+    };
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0xF8, 0, 0, 1, 11);
+    assertMessage(0xF0, 0, 0, 0, 12);
+
+    uint8_t sysex[MidiParser::SYSEX_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_size_t(3, parser.readSysEx(sysex, sizeof(sysex)));
+    TEST_ASSERT_EQUAL_UINT8(3, sysex[2]);
+}
+
+void test_ring_full() {
+    // The consumer stalls: the oldest QUEUE_SIZE messages are kept in order
+    uint32_t overflows = parser.getOverflowCount();
+    const uint32_t sent = MidiParser::QUEUE_SIZE + 5;
+    for (uint32_t i = 0; i < sent; i++) {
+        const uint8_t packet[] = {header(i), stamp(i), 0xB0, 1, (uint8_t)i};
+        parser.parse(packet, sizeof(packet));
+    }
+    TEST_ASSERT_EQUAL_UINT32(overflows + 5, parser.getOverflowCount());
+
+    for (uint32_t i = 0; i < MidiParser::QUEUE_SIZE; i++) {
+        assertMessage(0xB0, 1, (uint8_t)i, 3, i);
+    }
+    MidiMessage message;
+    TEST_ASSERT_FALSE(parser.pop(message));
+
+    // Room again once the consumer catches up
+    const uint8_t packet[] = {header(0), stamp(0), 0xC0, 9};
+    parser.parse(packet, sizeof(packet));
+    assertMessage(0xC0, 9, 0, 2, 0);
+}
+
+void test_benchmark() {
+    // A dense DAW packet: 8 CCs with running status and a clock
+    uint8_t packet[MidiParser::SYSEX_BUFFER_SIZE];
+    size_t length = 0;
+    packet[length++] = header(0);
+    packet[length++] = stamp(0);
+    packet[length++] = 0xB0;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (i > 0) packet[length++] = stamp(i);
+        packet[length++] = i;
+        packet[length++] = 64 + i;
+    }
+    packet[length++] = stamp(9);
+    packet[length++] = 0xF8;
+    const uint32_t perPacket = 9;
+
+    const uint32_t packets = 200000;
+    uint32_t before = parser.getMessageCount();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < packets; i++) {
+        parser.parse(packet, length);
+        MidiMessage message;
+        while (parser.pop(message)) {
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint32_t decoded = parser.getMessageCount() - before;
+    TEST_ASSERT_EQUAL_UINT32(packets * perPacket, decoded);
+
+    char line[96];
+    snprintf(line, sizeof(line), "MidiParser: %.1f M messages/s (%u messages, %.3f s)",
+             decoded / elapsed.count() / 1e6, (unsigned)decoded, elapsed.count());
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_message);
+    RUN_TEST(test_bad_headers);
+    RUN_TEST(test_truncated_packets);
+    RUN_TEST(test_random_packets);
+    RUN_TEST(test_timestamp_low_byte_wrap);
+    RUN_TEST(test_timestamp_13_bit_wrap);
+    RUN_TEST(test_timestamp_wrap_is_per_packet);
+    RUN_TEST(test_running_status);
+    RUN_TEST(test_running_status_cleared_by_system_common);
+    RUN_TEST(test_sysex_multi_packet);
+    RUN_TEST(test_sysex_exactly_fills_buffer);
+    RUN_TEST(test_sysex_overflow);
+    RUN_TEST(test_sysex_waits_for_consumer);
+    RUN_TEST(test_realtime_inside_sysex);
+    RUN_TEST(test_ring_full);
+    RUN_TEST(test_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+/*
+ * MIDI Packet Builder Tests
+ * Timestamp rules of add() and timestampFromMicros()
+ *
+ * Packets are decoded back as a BLE-MIDI receiver does: the header gives
+ * bits 12-7, each timestamp byte bits 6-0, and a low byte going backwards
+ * inside the packet advances the high bits by one.
+ */
+
+#include <unity.h>
+
+// Module under test, built from the shared library for the host
+#include "../../lib/MidiPacketBuilder/MidiPacketBuilder.cpp"
+
+static MidiPacketBuilder builder;
+
+struct Decoded {
+    uint16_t timestamp;
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+};
+
+static size_t decode(const uint8_t* data, uint16_t length, Decoded* out, size_t maxOut) {
+    uint8_t high = data[0] & 0x3F;
+    uint8_t lastLow = 0;
+    bool haveLow = false;
+    uint16_t timestamp = 0;
+    uint8_t status = 0;
+    size_t count = 0;
+    uint16_t i = 1;
+
+    while (i < length && count < maxOut) {
+        if (data[i] & 0x80) {
+            uint8_t low = data[i++] & 0x7F;
+            if (haveLow && low < lastLow) {
+                high = (high + 1) & 0x3F;
+            }
+            lastLow = low;
+            haveLow = true;
+            timestamp = ((uint16_t)high << 7) | low;
+            if (data[i] & 0x80) {
+                status = data[i++];
+            }
+        }
+        Decoded& message = out[count++];
+        message.timestamp = timestamp;
+        message.status = status;
+        message.data1 = data[i++];
+        message.data2 = ((status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0) ? 0 : data[i++];
+    }
+    return count;
+}
+
+static bool addCc(uint16_t timestamp, uint8_t value) {
+    const uint8_t message[] = {0xB0, 1, value};
+    return builder.add(timestamp, message, sizeof(message));
+}
+
+static void assertDecodes(const uint16_t* timestamps, size_t count) {
+    Decoded decoded[32];
+    TEST_ASSERT_EQUAL_size_t(count, decode(builder.getData(), builder.getLength(), decoded, 32));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT16(timestamps[i], decoded[i].timestamp);
+        TEST_ASSERT_EQUAL_HEX8(0xB0, decoded[i].status);
+        TEST_ASSERT_EQUAL_UINT8(i, decoded[i].data2);
+    }
+}
+
+void setUp() {
+    builder.clear();
+    builder.setMtu(247);
+    builder.setRunningStatus(true);
+}
+
+void tearDown() {
+}
+
+void test_timestamp_from_micros() {
+    TEST_ASSERT_EQUAL_UINT16(0, MidiPacketBuilder::timestampFromMicros(0));
+    TEST_ASSERT_EQUAL_UINT16(0, MidiPacketBuilder::timestampFromMicros(999));
+    TEST_ASSERT_EQUAL_UINT16(1, MidiPacketBuilder::timestampFromMicros(1000));
+    TEST_ASSERT_EQUAL_UINT16(1234, MidiPacketBuilder::timestampFromMicros(1234567));
+    TEST_ASSERT_EQUAL_UINT16(0x1FFF, MidiPacketBuilder::timestampFromMicros(8191999));
+    TEST_ASSERT_EQUAL_UINT16(0, MidiPacketBuilder::timestampFromMicros(8192000));
+    // Days of uptime still fold onto the 13-bit millisecond clock
+    int64_t uptimeUs = 3LL * 24 * 3600 * 1000000 + 4321000;
+    TEST_ASSERT_EQUAL_UINT16((uptimeUs / 1000) & 0x1FFF, MidiPacketBuilder::timestampFromMicros(uptimeUs));
+    TEST_ASSERT_EQUAL_UINT16(MidiPacketBuilder::timestampFromMillis(uptimeUs / 1000),
+                             MidiPacketBuilder::timestampFromMicros(uptimeUs));
+}
+
+void test_same_high_bits() {
+    const uint16_t timestamps[] = {0x0280, 0x0285, 0x02FF};
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(addCc(timestamps[i], i));
+    }
+    TEST_ASSERT_EQUAL_HEX8(0x80 | 0x05, builder.getData()[0]);
+    assertDecodes(timestamps, 3);
+}
+
+void test_low_byte_wrap_stays_in_packet() {
+    // The low byte decreases while the high bits advance by one
+    const uint16_t timestamps[] = {0x02FE, 0x0302, 0x0310};
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(addCc(timestamps[i], i));
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, builder.getPendingMessages());
+    assertDecodes(timestamps, 3);
+}
+
+void test_13_bit_wrap_stays_in_packet() {
+    const uint16_t timestamps[] = {0x1FFE, 0x0001};
+    TEST_ASSERT_TRUE(addCc(timestamps[0], 0));
+    TEST_ASSERT_TRUE(addCc(timestamps[1], 1));
+    assertDecodes(timestamps, 2);
+}
+
+void test_high_jump_needs_new_header() {
+    // More than one high step cannot be told apart by the receiver
+    TEST_ASSERT_TRUE(addCc(0x0290, 0));
+    uint16_t length = builder.getLength();
+    TEST_ASSERT_FALSE(addCc(0x0385, 1));
+    TEST_ASSERT_EQUAL_UINT16(length, builder.getLength());
+    TEST_ASSERT_EQUAL_UINT8(1, builder.getPendingMessages());
+
+    // One high step without the low byte going backwards is 128 ms or more
+    TEST_ASSERT_FALSE(addCc(0x0310, 1));
+    TEST_ASSERT_EQUAL_UINT16(length, builder.getLength());
+
+    // The caller sends the packet, the message starts the next one
+    builder.markSent();
+    TEST_ASSERT_TRUE(addCc(0x0385, 0));
+    TEST_ASSERT_EQUAL_HEX8(0x80 | 0x07, builder.getData()[0]);
+    const uint16_t timestamps[] = {0x0385};
+    assertDecodes(timestamps, 1);
+}
+
+void test_earlier_stamp_clamped() {
+    // Another button scanned later in the pass, pressed a little earlier
+    TEST_ASSERT_TRUE(addCc(1000, 0));
+    TEST_ASSERT_TRUE(addCc(990, 1));
+    TEST_ASSERT_TRUE(addCc(1002, 2));
+    const uint16_t timestamps[] = {1000, 1000, 1002};
+    assertDecodes(timestamps, 3);
+}
+
+void test_earlier_stamp_clamped_across_wrap() {
+    // 0x0002 after 0x1FFE is later, 0x1FF0 is earlier and clamped
+    TEST_ASSERT_TRUE(addCc(0x1FFE, 0));
+    TEST_ASSERT_TRUE(addCc(0x0002, 1));
+    TEST_ASSERT_TRUE(addCc(0x1FF0, 2));
+    const uint16_t timestamps[] = {0x1FFE, 0x0002, 0x0002};
+    assertDecodes(timestamps, 3);
+}
+
+void test_running_status_drops_repeated_bytes() {
+    TEST_ASSERT_TRUE(addCc(500, 0));
+    uint16_t first = builder.getLength();
+    TEST_ASSERT_TRUE(addCc(500, 1));  // Same status and time: data only
+    TEST_ASSERT_EQUAL_UINT16(first + 2, builder.getLength());
+    TEST_ASSERT_TRUE(addCc(501, 2));  // New time: timestamp and data
+    TEST_ASSERT_EQUAL_UINT16(first + 5, builder.getLength());
+
+    const uint16_t timestamps[] = {500, 500, 501};
+    assertDecodes(timestamps, 3);
+}
+
+void test_rejects_invalid_messages() {
+    const uint8_t noStatus[] = {0x01, 0x02, 0x03};
+    const uint8_t tooLong[] = {0xB0, 1, 2, 3};
+    TEST_ASSERT_FALSE(builder.add(0, noStatus, sizeof(noStatus)));
+    TEST_ASSERT_FALSE(builder.add(0, tooLong, sizeof(tooLong)));
+    TEST_ASSERT_FALSE(builder.add(0, tooLong, 0));
+    TEST_ASSERT_TRUE(builder.isEmpty());
+}
+
+void test_packet_full() {
+    builder.setMtu(23);  // 20-byte payload
+    uint8_t added = 0;
+    while (addCc(100 + added, added)) {
+        added++;
+    }
+    TEST_ASSERT_TRUE(builder.getLength() <= 20);
+    TEST_ASSERT_EQUAL_UINT8(added, builder.getPendingMessages());
+
+    uint16_t timestamps[32];
+    for (uint8_t i = 0; i < added; i++) {
+        timestamps[i] = 100 + i;
+    }
+    assertDecodes(timestamps, added);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_timestamp_from_micros);
+    RUN_TEST(test_same_high_bits);
+    RUN_TEST(test_low_byte_wrap_stays_in_packet);
+    RUN_TEST(test_13_bit_wrap_stays_in_packet);
+    RUN_TEST(test_high_jump_needs_new_header);
+    RUN_TEST(test_earlier_stamp_clamped);
+    RUN_TEST(test_earlier_stamp_clamped_across_wrap);
+    RUN_TEST(test_running_status_drops_repeated_bytes);
+    RUN_TEST(test_rejects_invalid_messages);
+    RUN_TEST(test_packet_full);
+    return UNITY_END();
+}